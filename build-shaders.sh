@@ -5,3 +5,5 @@ echo compile psmain.glsl...
 glslc -fshader-stage=frag ./src/shaders/psmain.glsl -o ./build/psmain.spv
 echo compile vsmain.glsl...
 glslc -fshader-stage=vert ./src/shaders/vsmain.glsl -o ./build/vsmain.spv
+echo compile cull.glsl...
+glslc -fshader-stage=comp ./src/shaders/cull.glsl -o ./build/cull.spv
@@ -0,0 +1,121 @@
+#include "app_options.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace vulkan_tutorial {
+    app_options app_options::parse(int argc, char** argv) {
+        app_options options = {};
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            if (arg == "--benchmark") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--benchmark expects a frame count");
+
+                char* end = nullptr;
+                unsigned long frames = std::strtoul(argv[++i], &end, 10);
+                if (end == argv[i] || *end != '\0' || frames == 0ul)
+                    throw std::invalid_argument("--benchmark expects a positive frame count");
+
+                options.benchmarkFrames = static_cast<uint32_t>(frames);
+            }
+            else if (arg == "--warmup") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--warmup expects a frame count");
+
+                char* end = nullptr;
+                unsigned long frames = std::strtoul(argv[++i], &end, 10);
+                if (end == argv[i] || *end != '\0')
+                    throw std::invalid_argument("--warmup expects a frame count");
+
+                options.warmupFrames = static_cast<uint32_t>(frames);
+            }
+            else if (arg == "--report") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--report expects an output path");
+
+                options.reportPath = argv[++i];
+            }
+            else if (arg == "--headless") {
+                options.headless = true;
+            }
+            else if (arg == "--readback") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--readback expects an output path");
+
+                options.readbackPath = argv[++i];
+            }
+            else if (arg == "--trace") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--trace expects an output path");
+
+                options.tracePath = argv[++i];
+            }
+            else if (arg == "--serialize-frames") {
+                options.serializeFrames = true;
+            }
+            else if (arg == "--split-meshes") {
+                options.splitMeshes = true;
+            }
+            else if (arg == "--gpu-culling") {
+                options.gpuCulling = true;
+            }
+            else if (arg == "--compact-vertices") {
+                options.compactVertices = true;
+            }
+            else if (arg == "--model") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--model expects an OBJ path");
+
+                options.modelPaths.push_back(argv[++i]);
+            }
+            else if (arg == "--instances") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--instances expects an instance count");
+
+                char* end = nullptr;
+                unsigned long instances = std::strtoul(argv[++i], &end, 10);
+                if (end == argv[i] || *end != '\0' || instances == 0ul)
+                    throw std::invalid_argument("--instances expects a positive instance count");
+
+                options.instanceCount = static_cast<uint32_t>(instances);
+            }
+            else if (arg == "--texture-budget") {
+                if (i + 1 >= argc)
+                    throw std::invalid_argument("--texture-budget expects a size in MiB");
+
+                char* end = nullptr;
+                unsigned long mebibytes = std::strtoul(argv[++i], &end, 10);
+                if (end == argv[i] || *end != '\0')
+                    throw std::invalid_argument("--texture-budget expects a size in MiB");
+
+                options.textureBudgetMiB = static_cast<uint32_t>(mebibytes);
+            }
+            else {
+                throw std::invalid_argument("unknown argument: " + arg);
+            }
+        }
+
+        if (options.headless && options.benchmarkFrames == 0u)
+            throw std::invalid_argument("--headless needs --benchmark to know when to stop");
+        if (options.warmupFrames > 0u && options.benchmarkFrames == 0u)
+            throw std::invalid_argument("--warmup is only supported with --benchmark");
+        if (!options.reportPath.empty() && options.benchmarkFrames == 0u)
+            throw std::invalid_argument("--report is only supported with --benchmark");
+        if (!options.readbackPath.empty() && !options.headless)
+            throw std::invalid_argument("--readback is only supported with --headless");
+
+        return options;
+    }
+
+    void app_options::printUsage(const char* program) {
+        std::cerr << "usage: " << program << " [--benchmark <frames> [--warmup <frames>] [--report <file.json>]]"
+            << " [--serialize-frames] [--texture-budget <MiB>] [--compact-vertices] [--split-meshes]"
+            << " [--model <file.obj>]... [--instances <count>] [--gpu-culling]"
+            << " [--headless [--readback <file.ppm>]] [--trace <file.json>]" << std::endl;
+    }
+}
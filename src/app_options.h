@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct app_options {
+        // Render this many frames, print throughput and exit. Zero runs until the window is closed.
+        uint32_t benchmarkFrames;
+        // Frames rendered before the benchmark starts measuring.
+        uint32_t warmupFrames;
+        // Write the benchmark results to this file as JSON.
+        std::string reportPath;
+        // Render into offscreen images without a window, surface or swapchain. Needs a benchmark frame count.
+        bool headless;
+        // Copy every headless frame back to host memory and write the last one to this file as a PPM image.
+        std::string readbackPath;
+        // Write every profiled CPU scope and GPU frame to this file in Chrome's trace event format.
+        std::string tracePath;
+        // Wait for the present queue to go idle after every frame, the way the renderer used to work.
+        bool serializeFrames;
+        // Split meshes with more vertices than 16-bit indices can address into sub-meshes that can use them.
+        bool splitMeshes;
+        // Models to load instead of the chalet. Instances cycle through them.
+        std::vector<std::string> modelPaths;
+        // Draw this many instances of the models on a grid. Zero draws a single one.
+        uint32_t instanceCount;
+        // Frustum cull instances in a compute pass and draw the survivors with indirect draws.
+        bool gpuCulling;
+        // Upload vertices as 16-bit normalized positions and texture coordinates instead of floats.
+        bool compactVertices;
+        // Streamed texture levels are evicted to stay within this many MiB of video memory. Zero means no budget.
+        uint32_t textureBudgetMiB;
+
+        static app_options parse(int argc, char** argv);
+        static void printUsage(const char* program);
+    };
+}
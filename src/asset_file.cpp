@@ -0,0 +1,50 @@
+#include "asset_file.h"
+
+#include <sys/stat.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    uint64_t computeAssetChecksum(const char* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull ^ size;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+            hash ^= hash >> 29;
+        }
+        for (; i < size; ++i) {
+            hash = (hash ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool statAssetFile(const std::string& path, uint64_t& size, int64_t& modifiedTime) {
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0)
+            return false;
+
+        size = static_cast<uint64_t>(fileStat.st_size);
+        modifiedTime = static_cast<int64_t>(fileStat.st_mtime);
+        return true;
+    }
+
+    void writeAssetFile(const std::string& path, const char* data, size_t size) {
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(data, size);
+            if (!file)
+                throw std::runtime_error("failed to write " + tempPath);
+        }
+
+        if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+            std::remove(tempPath.c_str());
+            throw std::runtime_error("failed to replace " + path);
+        }
+    }
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace vulkan_tutorial {
+    // Word-at-a-time hash used to verify the payload of the binary asset caches, fast enough to run on every load.
+    uint64_t computeAssetChecksum(const char* data, size_t size);
+
+    // Size and modification time of the file at path, used to tell whether a cache is older than its source.
+    // Returns false if the file doesn't exist.
+    bool statAssetFile(const std::string& path, uint64_t& size, int64_t& modifiedTime);
+
+    // Writes data next to path and renames it into place, so a crash never leaves a half written file behind.
+    void writeAssetFile(const std::string& path, const char* data, size_t size);
+}
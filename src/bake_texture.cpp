@@ -0,0 +1,51 @@
+#include "job_system.h"
+#include "texture_baker.h"
+#include "texture_file.h"
+
+#include <stb/stb_image.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+// Offline counterpart of the texture baking hello_triangle_app does on first run: decodes an image and writes
+// its block-compressed mip chain, so the baked file can be shipped next to (or instead of) the source image.
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "usage: " << argv[0] << " <source image> <baked texture>" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try {
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load(argv[1], &width, &height, &channels, STBI_rgb_alpha);
+        if (pixels == nullptr)
+            throw std::runtime_error(std::string("failed to load ") + argv[1]);
+
+        vulkan_tutorial::job_system jobs;
+        vulkan_tutorial::texture_baker baker(jobs);
+        vulkan_tutorial::texture_image image = baker.bake(
+            pixels,
+            static_cast<uint32_t>(width),
+            static_cast<uint32_t>(height),
+            true);
+        stbi_image_free(pixels);
+
+        vulkan_tutorial::texture_file::write(argv[2], argv[1], image);
+
+        const auto& stats = baker.getStats();
+        std::cout << "baked " << argv[1] << " (" << width << 'x' << height << ") into " << argv[2] << ": "
+            << image.levels.size() << " mips, "
+            << (image.format == VK_FORMAT_BC3_UNORM_BLOCK ? "BC3" : "BC1") << ", "
+            << stats.sourceBytes / 1024u << " KiB -> " << stats.bakedBytes / 1024u << " KiB in "
+            << (stats.mipSeconds + stats.compressSeconds) * 1000.0 << " ms (mips "
+            << stats.mipSeconds * 1000.0 << " ms, compression " << stats.compressSeconds * 1000.0 << " ms)"
+            << std::endl;
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include "benchmark_report.h"
+#include "json.h"
+
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+    void writeStats(std::ostream& out, const vulkan_tutorial::profile_stats& stats) {
+        out << "{\"count\":" << stats.windowCount
+            << ",\"min\":" << stats.min
+            << ",\"mean\":" << stats.mean
+            << ",\"p50\":" << stats.p50
+            << ",\"p95\":" << stats.p95
+            << ",\"p99\":" << stats.p99
+            << ",\"max\":" << stats.max << '}';
+    }
+}
+
+namespace vulkan_tutorial {
+    void benchmark_report::write(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file)
+            throw std::runtime_error("failed to open " + path + " for writing");
+
+        file << std::fixed << std::setprecision(4);
+        file << "{\n  \"device\": ";
+        writeJsonString(file, deviceName);
+        file << ",\n  \"headless\": " << (headless ? "true" : "false")
+            << ",\n  \"serializeFrames\": " << (serializeFrames ? "true" : "false")
+            << ",\n  \"gpuCulling\": " << (gpuCulling ? "true" : "false")
+            << ",\n  \"warmupFrames\": " << warmupFrames
+            << ",\n  \"measuredFrames\": " << measuredFrames
+            << ",\n  \"instances\": " << instanceCount
+            << ",\n  \"draws\": " << drawCount
+            << ",\n  \"timestep\": " << timestep
+            << ",\n  \"startupMs\": " << startupTime
+            << ",\n  \"startupSteps\": [";
+        for (size_t i = 0; i < startupSteps.size(); ++i) {
+            const auto& step = startupSteps[i];
+            file << (i == 0u ? "\n    {\"name\":" : ",\n    {\"name\":");
+            writeJsonString(file, step.name);
+            file << ",\"background\":" << (step.background ? "true" : "false")
+                << ",\"startMs\":" << step.start
+                << ",\"durationMs\":" << step.duration << '}';
+        }
+        file << "\n  ]"
+            << ",\n  \"totalMs\": " << totalTime
+            << ",\n  \"fps\": " << (totalTime > 0.0 ? measuredFrames * 1000.0 / totalTime : 0.0)
+            << ",\n  \"frameTimeMs\": ";
+        writeStats(file, frameTimes);
+
+        file << ",\n  \"stagesMs\": {";
+        for (size_t i = 0; i < stages.size(); ++i) {
+            file << (i == 0u ? "\n    " : ",\n    ");
+            writeJsonString(file, stages[i].name);
+            file << ": ";
+            writeStats(file, stages[i]);
+        }
+        file << "\n  }\n}\n";
+
+        if (!file)
+            throw std::runtime_error("failed to write " + path);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "profiler.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // One step of setting up the renderer. Background steps run on the job system alongside the others.
+    struct startup_step {
+        std::string name;
+        bool background;
+        // since startup began
+        double start;
+        double duration;
+    };
+
+    // Results of one benchmark run, written as JSON so runs on different commits can be diffed or fed to a
+    // regression check. Times are in milliseconds.
+    struct benchmark_report {
+        std::string deviceName;
+        bool headless;
+        bool serializeFrames;
+        bool gpuCulling;
+        uint32_t warmupFrames;
+        uint32_t measuredFrames;
+        uint32_t instanceCount;
+        // draw calls per frame
+        uint32_t drawCount;
+        // simulated seconds per frame
+        double timestep;
+        double startupTime;
+        std::vector<startup_step> startupSteps;
+        double totalTime;
+        profile_stats frameTimes;
+        // CPU stages and GPU passes over the measured frames, as far as the profiler's window reaches
+        std::vector<profile_stats> stages;
+
+        void write(const std::string& path) const;
+    };
+}
@@ -0,0 +1,314 @@
+#include "device_memory_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        if (alignment <= 1u)
+            return value;
+        return (value + alignment - 1u) / alignment * alignment;
+    }
+
+    bool kindsConflict(vulkan_tutorial::resource_kind a, vulkan_tutorial::resource_kind b) {
+        return a != vulkan_tutorial::resource_kind::free
+            && b != vulkan_tutorial::resource_kind::free
+            && a != b;
+    }
+
+    bool onSamePage(VkDeviceSize endOfFirst, VkDeviceSize startOfSecond, VkDeviceSize pageSize) {
+        return (endOfFirst - 1u) / pageSize == startOfSecond / pageSize;
+    }
+}
+
+namespace vulkan_tutorial {
+    device_memory_allocator::device_memory_allocator()
+      : _blocks {},
+        _bufferImageGranularity {1u},
+        _device {VK_NULL_HANDLE},
+        _maxAllocationCount {0u},
+        _memoryProperties {},
+        _nextBlockId {0u}
+    {}
+
+    device_memory_allocator::~device_memory_allocator() {
+        destroy();
+    }
+
+    device_allocation device_memory_allocator::allocate(
+        const VkMemoryRequirements& requirements,
+        uint32_t memoryTypeIndex,
+        resource_kind kind
+    ) {
+        if (kind == resource_kind::free)
+            throw std::invalid_argument("cannot allocate memory for a free resource");
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        device_allocation allocation = {};
+        VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+        if (requirements.size > blockSize / 2u) {
+            auto& block = createBlock(memoryTypeIndex, requirements.size, true);
+            tryAllocate(block, requirements, kind, allocation);
+            return allocation;
+        }
+
+        for (auto& block : _blocks) {
+            if (block.dedicated || block.memoryTypeIndex != memoryTypeIndex)
+                continue;
+            if (block.size - block.used < requirements.size)
+                continue;
+            if (tryAllocate(block, requirements, kind, allocation))
+                return allocation;
+        }
+
+        auto& block = createBlock(memoryTypeIndex, blockSize, false);
+        if (!tryAllocate(block, requirements, kind, allocation))
+            throw std::runtime_error("failed to sub-allocate from a fresh device memory block");
+
+        return allocation;
+    }
+
+    device_memory_allocator::memory_block& device_memory_allocator::createBlock(
+        uint32_t memoryTypeIndex,
+        VkDeviceSize size,
+        bool dedicated
+    ) {
+        if (_blocks.size() >= _maxAllocationCount)
+            throw std::runtime_error("reached maxMemoryAllocationCount");
+
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        memory_block block = {};
+        block.id = _nextBlockId++;
+        block.memoryTypeIndex = memoryTypeIndex;
+        block.size = size;
+        block.used = 0u;
+        block.allocationCount = 0u;
+        block.dedicated = dedicated;
+        block.mapped = nullptr;
+        block.chunks.emplace(0u, sub_allocation { size, resource_kind::free });
+
+        VkResult result = vkAllocateMemory(_device, &allocInfo, nullptr, &block.memory);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate device memory block");
+
+        VkMemoryPropertyFlags propertyFlags = _memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+        if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            result = vkMapMemory(_device, block.memory, 0u, VK_WHOLE_SIZE, 0u, &block.mapped);
+            if (result != VK_SUCCESS) {
+                vkFreeMemory(_device, block.memory, nullptr);
+                throw std::runtime_error("failed to map host visible device memory block");
+            }
+        }
+
+        _blocks.push_back(std::move(block));
+        return _blocks.back();
+    }
+
+    void device_memory_allocator::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (const auto& block : _blocks) {
+            if (block.mapped != nullptr)
+                vkUnmapMemory(_device, block.memory);
+            vkFreeMemory(_device, block.memory, nullptr);
+        }
+
+        _blocks.clear();
+        _bufferImageGranularity = 1u;
+        _device = VK_NULL_HANDLE;
+        _maxAllocationCount = 0u;
+        _memoryProperties = {};
+        _nextBlockId = 0u;
+    }
+
+    void device_memory_allocator::free(device_allocation& allocation) {
+        if (!allocation.isValid())
+            return;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto block = std::find_if(_blocks.begin(), _blocks.end(), [&allocation](const memory_block& b) {
+            return b.id == allocation.blockId;
+        });
+        if (block == _blocks.end())
+            throw std::invalid_argument("allocation does not belong to this allocator");
+
+        auto chunk = block->chunks.find(allocation.offset);
+        if (chunk == block->chunks.end() || chunk->second.kind == resource_kind::free)
+            throw std::invalid_argument("allocation was already freed");
+
+        block->used -= chunk->second.size;
+        block->allocationCount -= 1u;
+        chunk->second.kind = resource_kind::free;
+
+        auto next = std::next(chunk);
+        if (next != block->chunks.end() && next->second.kind == resource_kind::free) {
+            chunk->second.size += next->second.size;
+            block->chunks.erase(next);
+        }
+
+        if (chunk != block->chunks.begin()) {
+            auto prev = std::prev(chunk);
+            if (prev->second.kind == resource_kind::free) {
+                prev->second.size += chunk->second.size;
+                block->chunks.erase(chunk);
+            }
+        }
+
+        if (block->dedicated && block->allocationCount == 0u) {
+            if (block->mapped != nullptr)
+                vkUnmapMemory(_device, block->memory);
+            vkFreeMemory(_device, block->memory, nullptr);
+            _blocks.erase(block);
+        }
+
+        allocation = {};
+    }
+
+    uint32_t device_memory_allocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0u; i < _memoryProperties.memoryTypeCount; ++i) {
+            bool matchesFilter = (typeFilter & (1u << i)) != 0u;
+            bool hasProperties = (_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties;
+            if (matchesFilter && hasProperties)
+                return i;
+        }
+
+        throw std::runtime_error("failed to find a suitable memory type");
+    }
+
+    VkDeviceSize device_memory_allocator::getBlockSize(uint32_t memoryTypeIndex) const {
+        uint32_t heapIndex = _memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        VkDeviceSize heapSize = _memoryProperties.memoryHeaps[heapIndex].size;
+        return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8u);
+    }
+
+    device_memory_stats device_memory_allocator::getStats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        device_memory_stats stats = {};
+        for (const auto& block : _blocks) {
+            stats.blockCount += 1u;
+            stats.allocationCount += block.allocationCount;
+            stats.bytesReserved += block.size;
+            stats.bytesUsed += block.used;
+        }
+        return stats;
+    }
+
+    device_memory_stats device_memory_allocator::getStats(uint32_t memoryTypeIndex) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        device_memory_stats stats = {};
+        for (const auto& block : _blocks) {
+            if (block.memoryTypeIndex != memoryTypeIndex)
+                continue;
+            stats.blockCount += 1u;
+            stats.allocationCount += block.allocationCount;
+            stats.bytesReserved += block.size;
+            stats.bytesUsed += block.used;
+        }
+        return stats;
+    }
+
+    void device_memory_allocator::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+        destroy();
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &_memoryProperties);
+
+        _device = device;
+        _bufferImageGranularity = std::max<VkDeviceSize>(deviceProperties.limits.bufferImageGranularity, 1u);
+        _maxAllocationCount = deviceProperties.limits.maxMemoryAllocationCount;
+    }
+
+    void device_memory_allocator::printStats(std::ostream& out) const {
+        out << "device memory:" << std::endl;
+        for (uint32_t i = 0u; i < _memoryProperties.memoryTypeCount; ++i) {
+            auto stats = getStats(i);
+            if (stats.blockCount == 0u)
+                continue;
+
+            out << "  memory type #" << i << ": "
+                << stats.allocationCount << " allocations in "
+                << stats.blockCount << " blocks, "
+                << stats.bytesUsed / 1024u << " KiB used of "
+                << stats.bytesReserved / 1024u << " KiB reserved"
+                << std::endl;
+        }
+    }
+
+    bool device_memory_allocator::tryAllocate(
+        memory_block& block,
+        const VkMemoryRequirements& requirements,
+        resource_kind kind,
+        device_allocation& allocation
+    ) {
+        for (auto chunk = block.chunks.begin(); chunk != block.chunks.end(); ++chunk) {
+            if (chunk->second.kind != resource_kind::free || chunk->second.size < requirements.size)
+                continue;
+
+            VkDeviceSize chunkStart = chunk->first;
+            VkDeviceSize chunkEnd = chunk->first + chunk->second.size;
+            VkDeviceSize start = alignUp(chunkStart, requirements.alignment);
+
+            if (chunk != block.chunks.begin()) {
+                auto prev = std::prev(chunk);
+                if (kindsConflict(prev->second.kind, kind)
+                    && onSamePage(prev->first + prev->second.size, start, _bufferImageGranularity)
+                ) {
+                    start = alignUp(start, _bufferImageGranularity);
+                }
+            }
+
+            VkDeviceSize end = start + requirements.size;
+            if (end > chunkEnd)
+                continue;
+
+            auto next = std::next(chunk);
+            if (next != block.chunks.end()
+                && kindsConflict(kind, next->second.kind)
+                && onSamePage(end, next->first, _bufferImageGranularity)
+            ) {
+                continue;
+            }
+
+            if (start > chunkStart) {
+                chunk->second.size = start - chunkStart;
+                chunk = block.chunks.emplace_hint(next, start, sub_allocation { requirements.size, kind });
+            }
+            else {
+                chunk->second = sub_allocation { requirements.size, kind };
+            }
+
+            if (end < chunkEnd)
+                block.chunks.emplace_hint(next, end, sub_allocation { chunkEnd - end, resource_kind::free });
+
+            block.used += requirements.size;
+            block.allocationCount += 1u;
+
+            allocation.memory = block.memory;
+            allocation.offset = start;
+            allocation.size = requirements.size;
+            allocation.memoryTypeIndex = block.memoryTypeIndex;
+            allocation.blockId = block.id;
+            allocation.mapped = block.mapped == nullptr
+                ? nullptr
+                : static_cast<char*>(block.mapped) + start;
+            return true;
+        }
+
+        return false;
+    }
+}
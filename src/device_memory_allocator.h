@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Buffers and linear images are "linear" resources, optimally tiled images are not. Neighbouring linear and
+    // non-linear resources must not share a bufferImageGranularity page.
+    enum class resource_kind {
+        free,
+        linear,
+        optimal
+    };
+
+    struct device_allocation {
+        VkDeviceMemory memory;
+        VkDeviceSize offset;
+        VkDeviceSize size;
+        uint32_t memoryTypeIndex;
+        uint32_t blockId;
+        void* mapped;
+
+        bool isValid() const { return memory != VK_NULL_HANDLE; }
+    };
+
+    struct device_memory_stats {
+        uint32_t blockCount;
+        uint32_t allocationCount;
+        VkDeviceSize bytesReserved;
+        VkDeviceSize bytesUsed;
+    };
+
+    // Reserves large VkDeviceMemory blocks per memory type and sub-allocates resources out of them so that the
+    // number of vkAllocateMemory calls no longer scales with the number of buffers and images.
+    class device_memory_allocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024ull * 1024ull;
+
+        device_memory_allocator();
+        ~device_memory_allocator();
+
+        device_memory_allocator(const device_memory_allocator&) = delete;
+        device_memory_allocator& operator=(const device_memory_allocator&) = delete;
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device);
+        void destroy();
+
+        device_allocation allocate(
+            const VkMemoryRequirements& requirements,
+            uint32_t memoryTypeIndex,
+            resource_kind kind);
+        void free(device_allocation& allocation);
+
+        // First memory type allowed by typeFilter that has all of the given properties.
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+        device_memory_stats getStats() const;
+        device_memory_stats getStats(uint32_t memoryTypeIndex) const;
+        void printStats(std::ostream& out) const;
+
+    private:
+        struct sub_allocation {
+            VkDeviceSize size;
+            resource_kind kind;
+        };
+
+        struct memory_block {
+            uint32_t id;
+            uint32_t memoryTypeIndex;
+            VkDeviceMemory memory;
+            VkDeviceSize size;
+            VkDeviceSize used;
+            uint32_t allocationCount;
+            bool dedicated;
+            void* mapped;
+            std::map<VkDeviceSize, sub_allocation> chunks;
+        };
+
+        std::vector<memory_block> _blocks;
+        VkDeviceSize _bufferImageGranularity;
+        VkDevice _device;
+        uint32_t _maxAllocationCount;
+        VkPhysicalDeviceMemoryProperties _memoryProperties;
+        uint32_t _nextBlockId;
+        mutable std::mutex _mutex;
+
+        memory_block& createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+        VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+        bool tryAllocate(
+            memory_block& block,
+            const VkMemoryRequirements& requirements,
+            resource_kind kind,
+            device_allocation& allocation);
+    };
+}
@@ -0,0 +1,137 @@
+#include "geometry_arena.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    geometry_arena::geometry_arena()
+      : _allocator {nullptr},
+        _allocation {},
+        _buffer {VK_NULL_HANDLE},
+        _device {VK_NULL_HANDLE},
+        _freeRanges {},
+        _stats {}
+    {}
+
+    geometry_arena::~geometry_arena() {
+        destroy();
+    }
+
+    geometry_range geometry_arena::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        if (size == 0u)
+            throw std::invalid_argument("cannot allocate an empty geometry range");
+
+        alignment = std::max<VkDeviceSize>(alignment, 1u);
+        for (auto free = _freeRanges.begin(); free != _freeRanges.end(); ++free) {
+            VkDeviceSize freeBegin = free->first;
+            VkDeviceSize freeEnd = free->first + free->second;
+            VkDeviceSize offset = (freeBegin + alignment - 1u) / alignment * alignment;
+            if (offset + size > freeEnd)
+                continue;
+
+            _freeRanges.erase(free);
+            if (offset > freeBegin)
+                _freeRanges.emplace(freeBegin, offset - freeBegin);
+            if (offset + size < freeEnd)
+                _freeRanges.emplace(offset + size, freeEnd - offset - size);
+
+            _stats.usedBytes += size;
+            _stats.peakUsedBytes = std::max(_stats.peakUsedBytes, _stats.usedBytes);
+            _stats.rangeCount += 1u;
+            _stats.freeRangeCount = static_cast<uint32_t>(_freeRanges.size());
+            return geometry_range { offset, size };
+        }
+
+        throw std::runtime_error("geometry arena exhausted");
+    }
+
+    void geometry_arena::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyBuffer(_device, _buffer, nullptr);
+        _allocator->free(_allocation);
+
+        _allocator = nullptr;
+        _allocation = {};
+        _buffer = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+        _freeRanges.clear();
+        _stats = {};
+    }
+
+    void geometry_arena::free(geometry_range& range) {
+        if (!range.isValid())
+            return;
+
+        VkDeviceSize begin = range.offset;
+        VkDeviceSize end = range.offset + range.size;
+
+        auto next = _freeRanges.lower_bound(begin);
+        if (next != _freeRanges.end() && next->first == end) {
+            end += next->second;
+            next = _freeRanges.erase(next);
+        }
+        if (next != _freeRanges.begin()) {
+            auto previous = std::prev(next);
+            if (previous->first + previous->second == begin) {
+                begin = previous->first;
+                _freeRanges.erase(previous);
+            }
+        }
+        _freeRanges.emplace(begin, end - begin);
+
+        _stats.usedBytes -= range.size;
+        _stats.rangeCount -= 1u;
+        _stats.freeRangeCount = static_cast<uint32_t>(_freeRanges.size());
+        range = {};
+    }
+
+    void geometry_arena::init(
+        VkDevice device,
+        device_memory_allocator* allocator,
+        VkDeviceSize size
+    ) {
+        destroy();
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT
+            | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &_buffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create geometry arena buffer");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, _buffer, &memRequirements);
+
+        // from here on a throw leaves the arena for destroy() to clean up
+        _allocator = allocator;
+        _device = device;
+
+        _allocation = allocator->allocate(
+            memRequirements,
+            allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            resource_kind::linear);
+
+        result = vkBindBufferMemory(device, _buffer, _allocation.memory, _allocation.offset);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to bind geometry arena memory");
+
+        _freeRanges.emplace(0u, size);
+        _stats.size = size;
+        _stats.freeRangeCount = 1u;
+    }
+
+    void geometry_arena::printStats(std::ostream& out) const {
+        out << "geometry arena: " << _stats.usedBytes / 1024u << " of " << _stats.size / 1024u << " KiB used (peak "
+            << _stats.peakUsedBytes / 1024u << " KiB) in " << _stats.rangeCount << " ranges, "
+            << _stats.freeRangeCount << " free ranges" << std::endl;
+    }
+}
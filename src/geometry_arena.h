@@ -0,0 +1,60 @@
+#pragma once
+
+#include "device_memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <ostream>
+
+namespace vulkan_tutorial {
+    struct geometry_range {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+
+        bool isValid() const { return size > 0u; }
+    };
+
+    struct geometry_arena_stats {
+        VkDeviceSize size;
+        VkDeviceSize usedBytes;
+        VkDeviceSize peakUsedBytes;
+        uint32_t rangeCount;
+        uint32_t freeRangeCount;
+    };
+
+    // One device-local buffer usable as vertex, index and storage buffer that the vertex and index data of every mesh
+    // is sub-allocated from, so meshes cost neither a buffer, an allocation nor a bind of their own. Draws refer to
+    // a mesh through firstIndex and vertexOffset, which is why vertex ranges are aligned to the vertex stride and
+    // index ranges to the index size. Free ranges are kept sorted by offset and coalesced on free.
+    class geometry_arena {
+    public:
+        geometry_arena();
+        ~geometry_arena();
+
+        geometry_arena(const geometry_arena&) = delete;
+        geometry_arena& operator=(const geometry_arena&) = delete;
+
+        void init(
+            VkDevice device,
+            device_memory_allocator* allocator,
+            VkDeviceSize size);
+        void destroy();
+
+        // The alignment doesn't have to be a power of two, vertex strides rarely are.
+        geometry_range allocate(VkDeviceSize size, VkDeviceSize alignment);
+        void free(geometry_range& range);
+
+        VkBuffer getBuffer() const { return _buffer; }
+        const geometry_arena_stats& getStats() const { return _stats; }
+        void printStats(std::ostream& out) const;
+
+    private:
+        device_memory_allocator* _allocator;
+        device_allocation _allocation;
+        VkBuffer _buffer;
+        VkDevice _device;
+        // offset to size
+        std::map<VkDeviceSize, VkDeviceSize> _freeRanges;
+        geometry_arena_stats _stats;
+    };
+}
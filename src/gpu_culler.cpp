@@ -0,0 +1,381 @@
+#include "gpu_culler.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    // matches the push constant block of cull.glsl
+    struct cull_push_constants {
+        glm::vec4 frustumPlanes[6];
+        uint32_t instanceBase;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        uint32_t batchIndex;
+        uint32_t firstDraw;
+        uint32_t drawCount;
+        float radius;
+    };
+
+    // vkCmdUpdateBuffer takes at most this many bytes at once
+    const VkDeviceSize MAX_UPDATE_SIZE = 65536u;
+
+    // Gribb and Hartmann: the planes are sums and differences of the rows of the view projection matrix, with
+    // normals facing inwards. Depth runs from zero to one.
+    std::array<glm::vec4, 6> getFrustumPlanes(const glm::mat4& viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; ++i) {
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        }
+
+        std::array<glm::vec4, 6> planes = {
+            rows[3] + rows[0],
+            rows[3] - rows[0],
+            rows[3] + rows[1],
+            rows[3] - rows[1],
+            rows[2],
+            rows[3] - rows[2]
+        };
+        for (auto& plane : planes) {
+            plane = plane * (1.0f / glm::length(glm::vec3(plane)));
+        }
+        return planes;
+    }
+}
+
+namespace vulkan_tutorial {
+    gpu_culler::gpu_culler()
+      : _allocator {nullptr},
+        _batches {},
+        _descriptorPool {VK_NULL_HANDLE},
+        _descriptorSetLayout {VK_NULL_HANDLE},
+        _device {VK_NULL_HANDLE},
+        _drawsOffset {0u},
+        _frames {},
+        _indirectTemplate {},
+        _instanceBase {0u},
+        _pipeline {VK_NULL_HANDLE},
+        _pipelineLayout {VK_NULL_HANDLE}
+    {}
+
+    gpu_culler::~gpu_culler() {
+        destroy();
+    }
+
+    void gpu_culler::createBuffer(
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        VkBuffer& buffer,
+        device_allocation& allocation
+    ) {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &buffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling buffer");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
+
+        allocation = _allocator->allocate(
+            memRequirements,
+            _allocator->findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+            resource_kind::linear);
+
+        result = vkBindBufferMemory(_device, buffer, allocation.memory, allocation.offset);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to bind culling buffer memory");
+    }
+
+    void gpu_culler::createDescriptorSets(VkBuffer instanceBuffer) {
+        std::array<VkDescriptorSetLayoutBinding, 4> bindings = {};
+        for (uint32_t i = 0u; i < bindings.size(); ++i) {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            bindings[i].descriptorCount = 1u;
+            bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        VkResult result = vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_descriptorSetLayout);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling descriptor set layout");
+
+        uint32_t frameCount = static_cast<uint32_t>(_frames.size());
+        VkDescriptorPoolSize poolSize = {};
+        poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        poolSize.descriptorCount = static_cast<uint32_t>(bindings.size()) * frameCount;
+
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.poolSizeCount = 1u;
+        poolInfo.pPoolSizes = &poolSize;
+        poolInfo.maxSets = frameCount;
+
+        result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling descriptor pool");
+
+        std::vector<VkDescriptorSetLayout> layouts(frameCount, _descriptorSetLayout);
+        VkDescriptorSetAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = _descriptorPool;
+        allocInfo.descriptorSetCount = frameCount;
+        allocInfo.pSetLayouts = layouts.data();
+
+        std::vector<VkDescriptorSet> descriptorSets(frameCount);
+        result = vkAllocateDescriptorSets(_device, &allocInfo, descriptorSets.data());
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate culling descriptor sets");
+
+        for (uint32_t i = 0u; i < frameCount; ++i) {
+            auto& frame = _frames[i];
+            frame.descriptorSet = descriptorSets[i];
+
+            std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+            bufferInfos[0].buffer = instanceBuffer;
+            bufferInfos[0].offset = 0u;
+            bufferInfos[0].range = VK_WHOLE_SIZE;
+            bufferInfos[1].buffer = frame.instanceBuffer;
+            bufferInfos[1].offset = 0u;
+            bufferInfos[1].range = VK_WHOLE_SIZE;
+            bufferInfos[2].buffer = frame.indirectBuffer;
+            bufferInfos[2].offset = 0u;
+            bufferInfos[2].range = getCountOffset(static_cast<uint32_t>(_batches.size()));
+            bufferInfos[3].buffer = frame.indirectBuffer;
+            bufferInfos[3].offset = _drawsOffset;
+            bufferInfos[3].range = VK_WHOLE_SIZE;
+
+            std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+            for (uint32_t binding = 0u; binding < descriptorWrites.size(); ++binding) {
+                descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                descriptorWrites[binding].dstSet = frame.descriptorSet;
+                descriptorWrites[binding].dstBinding = binding;
+                descriptorWrites[binding].dstArrayElement = 0u;
+                descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                descriptorWrites[binding].descriptorCount = 1u;
+                descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+            }
+            vkUpdateDescriptorSets(
+                _device,
+                static_cast<uint32_t>(descriptorWrites.size()),
+                descriptorWrites.data(),
+                0u,
+                nullptr);
+        }
+    }
+
+    void gpu_culler::createPipeline(VkPipelineCache pipelineCache, const std::vector<char>& shaderCode) {
+        VkPushConstantRange pushConstantRange = {};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushConstantRange.offset = 0u;
+        pushConstantRange.size = sizeof(cull_push_constants);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1u;
+        pipelineLayoutInfo.pSetLayouts = &_descriptorSetLayout;
+        pipelineLayoutInfo.pushConstantRangeCount = 1u;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkResult result = vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling pipeline layout");
+
+        VkShaderModuleCreateInfo moduleInfo = {};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = shaderCode.size();
+        moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+        VkShaderModule shaderModule;
+        result = vkCreateShaderModule(_device, &moduleInfo, nullptr, &shaderModule);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling shader module");
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = _pipelineLayout;
+
+        result = vkCreateComputePipelines(_device, pipelineCache, 1u, &pipelineInfo, nullptr, &_pipeline);
+        vkDestroyShaderModule(_device, shaderModule, nullptr);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create culling pipeline");
+    }
+
+    void gpu_culler::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyPipeline(_device, _pipeline, nullptr);
+        vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+        vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
+        for (auto& frame : _frames) {
+            vkDestroyBuffer(_device, frame.indirectBuffer, nullptr);
+            _allocator->free(frame.indirectBufferAllocation);
+            vkDestroyBuffer(_device, frame.instanceBuffer, nullptr);
+            _allocator->free(frame.instanceBufferAllocation);
+        }
+
+        _allocator = nullptr;
+        _batches.clear();
+        _descriptorPool = VK_NULL_HANDLE;
+        _descriptorSetLayout = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+        _drawsOffset = 0u;
+        _frames.clear();
+        _indirectTemplate.clear();
+        _instanceBase = 0u;
+        _pipeline = VK_NULL_HANDLE;
+        _pipelineLayout = VK_NULL_HANDLE;
+    }
+
+    void gpu_culler::init(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        device_memory_allocator* allocator,
+        VkPipelineCache pipelineCache,
+        const std::vector<char>& shaderCode,
+        uint32_t frameCount,
+        VkBuffer instanceBuffer,
+        VkDeviceSize instanceOffset,
+        std::vector<cull_batch> batches,
+        const std::vector<VkDrawIndexedIndirectCommand>& draws
+    ) {
+        destroy();
+
+        if (instanceOffset % sizeof(glm::mat4) != 0u)
+            throw std::invalid_argument("culled instances have to start at a multiple of the transform size");
+
+        _allocator = allocator;
+        _batches = std::move(batches);
+        _device = device;
+        _instanceBase = static_cast<uint32_t>(instanceOffset / sizeof(glm::mat4));
+
+        uint32_t instanceCount = 0u;
+        for (const auto& batch : _batches) {
+            instanceCount = std::max(instanceCount, batch.firstInstance + batch.instanceCount);
+        }
+
+        // the draws are bound as a storage buffer of their own, so they start at a storage buffer offset
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+        VkDeviceSize alignment = std::max<VkDeviceSize>(
+            deviceProperties.limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+        VkDeviceSize countsSize = getCountOffset(static_cast<uint32_t>(_batches.size()));
+        _drawsOffset = (countsSize + alignment - 1u) / alignment * alignment;
+        VkDeviceSize indirectSize = _drawsOffset + sizeof(VkDrawIndexedIndirectCommand) * draws.size();
+
+        _indirectTemplate.assign(static_cast<size_t>(indirectSize / sizeof(uint32_t)), 0u);
+        for (size_t i = 0; i < draws.size(); ++i) {
+            VkDrawIndexedIndirectCommand draw = draws[i];
+            draw.instanceCount = 0u;
+            std::copy(
+                reinterpret_cast<const uint32_t*>(&draw),
+                reinterpret_cast<const uint32_t*>(&draw + 1),
+                _indirectTemplate.begin() + static_cast<ptrdiff_t>(getDrawOffset(static_cast<uint32_t>(i)) / 4u));
+        }
+
+        _frames.resize(frameCount);
+        for (auto& frame : _frames) {
+            createBuffer(
+                sizeof(glm::mat4) * std::max(instanceCount, 1u),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                frame.instanceBuffer,
+                frame.instanceBufferAllocation);
+            createBuffer(
+                indirectSize,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+                    | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+                    | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                frame.indirectBuffer,
+                frame.indirectBufferAllocation);
+        }
+
+        createDescriptorSets(instanceBuffer);
+        createPipeline(pipelineCache, shaderCode);
+    }
+
+    void gpu_culler::recordCulling(
+        VkCommandBuffer commandBuffer,
+        uint32_t frameIndex,
+        const glm::mat4& viewProjection
+    ) const {
+        const auto& frame = _frames[frameIndex];
+
+        // The frame's previous use of the buffer is complete, its fence has been waited on. The template is small
+        // enough to travel inside the command buffer.
+        VkDeviceSize templateSize = sizeof(uint32_t) * _indirectTemplate.size();
+        for (VkDeviceSize offset = 0u; offset < templateSize; offset += MAX_UPDATE_SIZE) {
+            vkCmdUpdateBuffer(
+                commandBuffer,
+                frame.indirectBuffer,
+                offset,
+                std::min(MAX_UPDATE_SIZE, templateSize - offset),
+                _indirectTemplate.data() + offset / sizeof(uint32_t));
+        }
+
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1u, &barrier,
+            0u, nullptr,
+            0u, nullptr
+        );
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout,
+            0u, 1u, &frame.descriptorSet,
+            0u, nullptr);
+
+        cull_push_constants constants = {};
+        auto planes = getFrustumPlanes(viewProjection);
+        std::copy(planes.begin(), planes.end(), constants.frustumPlanes);
+        constants.instanceBase = _instanceBase;
+
+        for (uint32_t i = 0u; i < _batches.size(); ++i) {
+            const auto& batch = _batches[i];
+            constants.firstInstance = batch.firstInstance;
+            constants.instanceCount = batch.instanceCount;
+            constants.batchIndex = i;
+            constants.firstDraw = batch.firstDraw;
+            constants.drawCount = batch.drawCount;
+            constants.radius = batch.radius;
+            vkCmdPushConstants(
+                commandBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                0u, sizeof(constants), &constants);
+            vkCmdDispatch(commandBuffer, (batch.instanceCount + WORKGROUP_SIZE - 1u) / WORKGROUP_SIZE, 1u, 1u);
+        }
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+            0,
+            1u, &barrier,
+            0u, nullptr,
+            0u, nullptr
+        );
+    }
+}
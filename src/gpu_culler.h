@@ -0,0 +1,95 @@
+#pragma once
+
+#include "device_memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // A run of instances sharing a mesh, and the indirect draws, one per sub-mesh, that draw whichever of them
+    // survive culling.
+    struct cull_batch {
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+        // of the bounding sphere around the mesh origin
+        float radius;
+        uint32_t firstDraw;
+        uint32_t drawCount;
+    };
+
+    // Frustum culls instances on the GPU. Every frame, a compute dispatch per batch tests each instance's bounding
+    // sphere, copies the transforms of the visible ones into a per-frame instance buffer and counts them into the
+    // instanceCount of the batch's VkDrawIndexedIndirectCommands. A batch with visible instances also gets its draw
+    // count set, for vkCmdDrawIndexedIndirectCountKHR to skip the others altogether. The CPU only records a
+    // dispatch and an indirect draw per batch, however many instances there are.
+    //
+    // The instance buffer is bound whole as a storage buffer, with the scene's instances starting at instanceOffset,
+    // which has to be a multiple of the size of a transform.
+    class gpu_culler {
+    public:
+        gpu_culler();
+        ~gpu_culler();
+
+        gpu_culler(const gpu_culler&) = delete;
+        gpu_culler& operator=(const gpu_culler&) = delete;
+
+        void init(
+            VkPhysicalDevice physicalDevice,
+            VkDevice device,
+            device_memory_allocator* allocator,
+            VkPipelineCache pipelineCache,
+            const std::vector<char>& shaderCode,
+            uint32_t frameCount,
+            VkBuffer instanceBuffer,
+            VkDeviceSize instanceOffset,
+            std::vector<cull_batch> batches,
+            const std::vector<VkDrawIndexedIndirectCommand>& draws);
+        void destroy();
+
+        // Records outside of a render pass. The results are made visible to indirect draws and vertex input.
+        void recordCulling(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection) const;
+
+        const std::vector<cull_batch>& getBatches() const { return _batches; }
+        // holds the draw counts followed by the draws
+        VkBuffer getIndirectBuffer(uint32_t frameIndex) const { return _frames[frameIndex].indirectBuffer; }
+        VkDeviceSize getCountOffset(uint32_t batch) const { return sizeof(uint32_t) * batch; }
+        VkDeviceSize getDrawOffset(uint32_t draw) const {
+            return _drawsOffset + sizeof(VkDrawIndexedIndirectCommand) * draw;
+        }
+        VkBuffer getVisibleInstanceBuffer(uint32_t frameIndex) const { return _frames[frameIndex].instanceBuffer; }
+
+    private:
+        // each batch's draws start at firstInstance, so the visible instances are laid out like the scene's
+        struct frame_resources {
+            VkBuffer instanceBuffer;
+            device_allocation instanceBufferAllocation;
+            VkBuffer indirectBuffer;
+            device_allocation indirectBufferAllocation;
+            VkDescriptorSet descriptorSet;
+        };
+
+        static const uint32_t WORKGROUP_SIZE = 64u;
+
+        device_memory_allocator* _allocator;
+        std::vector<cull_batch> _batches;
+        VkDescriptorPool _descriptorPool;
+        VkDescriptorSetLayout _descriptorSetLayout;
+        VkDevice _device;
+        VkDeviceSize _drawsOffset;
+        std::vector<frame_resources> _frames;
+        // the contents every frame's indirect buffer is reset to, draws with no instances and no draw counts
+        std::vector<uint32_t> _indirectTemplate;
+        uint32_t _instanceBase;
+        VkPipeline _pipeline;
+        VkPipelineLayout _pipelineLayout;
+
+        void createBuffer(
+            VkDeviceSize size,
+            VkBufferUsageFlags usage,
+            VkBuffer& buffer,
+            device_allocation& allocation);
+        void createDescriptorSets(VkBuffer instanceBuffer);
+        void createPipeline(VkPipelineCache pipelineCache, const std::vector<char>& shaderCode);
+    };
+}
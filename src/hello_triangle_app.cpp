@@ -1,37 +1,31 @@
 #include "hello_triangle_app.h"
+#include "benchmark_report.h"
+#include "obj_loader.h"
 #include "scoped_glfw_window.h"
+#include "uniform_ring_buffer.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtx/hash.hpp>
-#include <stb/stb_image.h>
-#include <tiny_obj_loader.h>
 
 #include <algorithm>
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <set>
 #include <sstream>
 #include <stdexcept>
-#include <unordered_map>
+#include <string>
+#include <utility>
 #include <vector>
 
-namespace std {
-    template<> struct hash<vulkan_tutorial::vertex> {
-        size_t operator()(vulkan_tutorial::vertex const& vertex) const {
-            return ((hash<glm::vec3>()(vertex.pos) ^
-                (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-                (hash<glm::vec2>()(vertex.texCoord) << 1);
-        }
-    };
-}
-
 namespace {
     VkApplicationInfo create_vk_application_info() {
         VkApplicationInfo appInfo = {};
@@ -80,6 +74,14 @@ namespace {
         return "Unknown Present Mode";
     }
 
+    float getBoundingRadius(const vulkan_tutorial::mesh_file& mesh) {
+        float radius = 0.0f;
+        for (size_t i = 0; i < mesh.getVertexCount(); ++i) {
+            radius = std::max(radius, glm::length(mesh.getVertices()[i].pos));
+        }
+        return radius;
+    }
+
     std::string getVersionString(uint32_t version) {
         std::stringstream out;
         out << VK_VERSION_MAJOR(version) << '.'
@@ -88,6 +90,19 @@ namespace {
         return out.str();
     }
 
+    bool isDeviceExtensionAvailable(VkPhysicalDevice physicalDevice, const char* name) {
+        uint32_t extensionCount = 0u;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        for (const auto& extension : extensions) {
+            if (std::strcmp(extension.extensionName, name) == 0)
+                return true;
+        }
+        return false;
+    }
+
     void print_device_extensions(VkPhysicalDevice physicalDevice) {
         uint32_t extensionCount = 0u;
         vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
@@ -100,6 +115,26 @@ namespace {
         }
     }
 
+    void printFrameTimes(const vulkan_tutorial::profile_stats& frameTimes) {
+        if (frameTimes.windowCount == 0u)
+            return;
+
+        std::cout << "frame times: min " << frameTimes.min
+            << " ms, mean " << frameTimes.mean
+            << " ms, p50 " << frameTimes.p50
+            << " ms, p95 " << frameTimes.p95
+            << " ms, p99 " << frameTimes.p99
+            << " ms, max " << frameTimes.max << " ms" << std::endl;
+    }
+
+    void printMeshOptimizeStats(const vulkan_tutorial::mesh_optimize_stats& stats) {
+        std::cout << "optimized " << stats.triangleCount << " triangles in "
+            << (stats.cacheSeconds + stats.overdrawSeconds + stats.fetchSeconds) * 1000.0 << " ms: ACMR "
+            << stats.before.acmr << " -> " << stats.after.acmr << ", ATVR "
+            << stats.before.atvr << " -> " << stats.after.atvr << " (" << stats.clusterCount << " clusters, "
+            << vulkan_tutorial::mesh_optimizer::STATS_CACHE_SIZE << "-entry FIFO)" << std::endl;
+    }
+
     void print_instance_extensions() {
         uint32_t extensionCount = 0u;
         vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -126,99 +161,114 @@ namespace {
 }
 
 namespace vulkan_tutorial {
-    std::array<VkVertexInputAttributeDescription, 3> vertex::getAttributeDescriptions() {
-        std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-
-        attributeDescriptions[0].binding = 0u;
-        attributeDescriptions[0].location = 0u;
-        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[0].offset = offsetof(vertex, pos);
-
-        attributeDescriptions[1].binding = 0u;
-        attributeDescriptions[1].location = 1u;
-        attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-        attributeDescriptions[1].offset = offsetof(vertex, color);
-
-        attributeDescriptions[2].binding = 0u;
-        attributeDescriptions[2].location = 2u;
-        attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-        attributeDescriptions[2].offset = offsetof(vertex, texCoord);
-
-        return attributeDescriptions;
-    }
-
-    VkVertexInputBindingDescription vertex::getBindingDescription() {
-        VkVertexInputBindingDescription bindingDescription = {};
-        bindingDescription.binding = 0u;
-        bindingDescription.stride = sizeof(vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-        return bindingDescription;
-    }
-
-    hello_triangle_app::hello_triangle_app()
-      : _colorImage {VK_NULL_HANDLE},
-        _colorImageMemory {VK_NULL_HANDLE},
+    hello_triangle_app::hello_triangle_app(const app_options& options)
+      : _allocator {},
+        _colorImage {VK_NULL_HANDLE},
+        _colorImageAllocation {},
         _colorImageView {VK_NULL_HANDLE},
         _commandBuffers {},
-        _commandPool {VK_NULL_HANDLE},
+        _commandPools {},
+        _commandRecordingTime {0.0},
+        _culler {},
+        _cullShaderCode {},
         _currentFrame(0u),
         _debugMessenger {nullptr},
         _depthImage {VK_NULL_HANDLE},
-        _depthImageMemory {VK_NULL_HANDLE},
+        _depthImageAllocation {},
         _depthImageView {VK_NULL_HANDLE},
+        _drawCommands {},
+        _drawIndirectCountSupported {false},
         _descriptorPool {VK_NULL_HANDLE},
         _descriptorSetLayout {VK_NULL_HANDLE},
+        _descriptorImageViews {},
         _descriptorSets {},
         _device {VK_NULL_HANDLE},
         _deviceExtensions {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
+            options.headless
+                ? std::vector<const char*> {}
+                : std::vector<const char*> { VK_KHR_SWAPCHAIN_EXTENSION_NAME }
         },
+        _frameNumber {0u},
+        _fragmentShaderCode {},
         _framebufferResized {false},
         _fullscreenToggleRequested {false},
+        _geometryArena {},
         _graphicsPipeline {VK_NULL_HANDLE},
         _graphicsQueue {VK_NULL_HANDLE},
         _imageAvailableSemaphores {},
-        _indexBuffer {VK_NULL_HANDLE},
-        _indexBufferMemory {VK_NULL_HANDLE},
-        _indices {},
+        _imagesInFlight {},
         _inFlightFences {},
+        _instanceBatches {},
+        _instanceRange {},
+        _jobs {},
         _instance {VK_NULL_HANDLE},
         _instanceExtensions {
             VK_KHR_DEVICE_GROUP_CREATION_EXTENSION_NAME,
-            VK_KHR_DISPLAY_EXTENSION_NAME,
-            VK_KHR_GET_DISPLAY_PROPERTIES_2_EXTENSION_NAME,
-            VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME,
-            VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME
+            VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
         },
-        _mipLevels {1u},
+        _meshes {},
+        _meshGeometries {},
+        _meshRadii {},
+        _meshRadius {0.0f},
+        _placeholderImage {VK_NULL_HANDLE},
+        _placeholderImageAllocation {},
+        _placeholderImageView {VK_NULL_HANDLE},
         _msaaSamples {VK_SAMPLE_COUNT_1_BIT},
+        _multiDrawIndirectSupported {false},
+        _offscreenImageAllocations {},
+        _options {options},
         _physicalDevices {},
+        _pipelineCache {},
         _pipelineLayout {VK_NULL_HANDLE},
         _presentQueue {VK_NULL_HANDLE},
+        _profiler {},
+        _queueFamilyIndices {},
+        _readbackBufferAllocations {},
+        _readbackBuffers {},
+        _recordedCommandBuffers {0u},
         _renderFinishedSemaphores {},
         _renderPass {VK_NULL_HANDLE},
+        _retiredTextures {},
+        _scene {},
+        _sceneRadius {0.0f},
+        _secondaryCommandBuffers {},
+        _secondaryCommandPools {},
+        _startTime {},
+        _startupSteps {},
+        _startupTime {0.0},
         _surface {VK_NULL_HANDLE},
+        _surfaceInstanceExtensions {
+            VK_KHR_DISPLAY_EXTENSION_NAME,
+            VK_KHR_GET_DISPLAY_PROPERTIES_2_EXTENSION_NAME,
+            VK_KHR_GET_SURFACE_CAPABILITIES_2_EXTENSION_NAME
+        },
         _swapchain {VK_NULL_HANDLE},
         _swapchainExtent {0u, 0u},
         _swapchainFramebuffers {},
         _swapchainImageFormat {VK_FORMAT_UNDEFINED},
         _swapchainImages {},
         _swapchainImageViews {},
+        _textureBaseLevel {0u},
+        _textureCompressionSupported {false},
+        _textureFile {},
+        _textureLoader {},
+        _textureResidency {static_cast<VkDeviceSize>(options.textureBudgetMiB) * 1024u * 1024u},
+        _textureResidencyIndex {0u},
         _textureImage {VK_NULL_HANDLE},
-        _textureImageMemory {VK_NULL_HANDLE},
+        _textureImageAllocation {},
         _textureImageView {VK_NULL_HANDLE},
         _textureSampler {VK_NULL_HANDLE},
-        _uniformBuffers {},
-        _uniformBuffersMemory {},
+        _transferContext {},
+        _transferQueue {VK_NULL_HANDLE},
+        _uploadContext {},
+        _uniformRing {},
         _validationLayers {
 #if ENABLE_VALIDATION_LAYERS
             "VK_LAYER_KHRONOS_validation"
 #endif
         },
-        _vertexBuffer {VK_NULL_HANDLE},
-        _vertexBufferMemory {VK_NULL_HANDLE},
-        _vertices {},
+        _vertexShaderCode {},
+        _vkCmdDrawIndexedIndirectCountKHR {nullptr},
         _window {}
     {}
 
@@ -227,32 +277,25 @@ namespace vulkan_tutorial {
     }
 
     void hello_triangle_app::run() {
-        initWindow();
-        initInputHandlers();
+        _startTime = std::chrono::high_resolution_clock::now();
+        if (!_options.headless) {
+            timeStartupStep("create window", false, [this]() {
+                initWindow();
+                initInputHandlers();
+            });
+        }
         initVulkan();
+        _startupTime = std::chrono::high_resolution_clock::now() - _startTime;
+
+        std::cout << "started up in " << _startupTime.count() << " ms:" << std::endl;
+        for (const auto& step : _startupSteps) {
+            std::cout << "  " << step.name << (step.background ? " (background)" : "") << ": "
+                << step.duration << " ms, from " << step.start << " ms" << std::endl;
+        }
         mainLoop();
         cleanup();
     }
 
-    VkCommandBuffer hello_triangle_app::beginSingleTimeCommands() {
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = _commandPool;
-        allocInfo.commandBufferCount = 1u;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(_device, &allocInfo, &commandBuffer);
-
-        VkCommandBufferBeginInfo beginInfo = {};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        return commandBuffer;
-    }
-
     bool hello_triangle_app::checkDeviceExtensionsSupport(VkPhysicalDevice device) const {
         uint32_t extensionCount;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -379,125 +422,198 @@ namespace vulkan_tutorial {
         if (_instance == VK_NULL_HANDLE)
             return;
 
+        // loader threads allocate staging memory, so they have to finish before anything is torn down
+        _textureLoader.destroy();
         cleanupSwapchain();
 
+        if (_swapchain != VK_NULL_HANDLE)
+            vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+        vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
+        vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+        vkDestroyRenderPass(_device, _renderPass, nullptr);
+        _uniformRing.destroy();
+        vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
         vkDestroySampler(_device, _textureSampler, nullptr);
+        destroyRetiredTextures(true);
         vkDestroyImageView(_device, _textureImageView, nullptr);
         vkDestroyImage(_device, _textureImage, nullptr);
-        vkFreeMemory(_device, _textureImageMemory, nullptr);
+        _allocator.free(_textureImageAllocation);
+        vkDestroyImageView(_device, _placeholderImageView, nullptr);
+        vkDestroyImage(_device, _placeholderImage, nullptr);
+        _allocator.free(_placeholderImageAllocation);
         vkDestroyDescriptorSetLayout(_device, _descriptorSetLayout, nullptr);
-        vkDestroyBuffer(_device, _indexBuffer, nullptr);
-        vkFreeMemory(_device, _indexBufferMemory, nullptr);
-        vkDestroyBuffer(_device, _vertexBuffer, nullptr);
-        vkFreeMemory(_device, _vertexBufferMemory, nullptr);
+        for (auto& geometry : _meshGeometries) {
+            _geometryArena.free(geometry.vertexRange);
+            _geometryArena.free(geometry.indexRange);
+        }
+        _geometryArena.free(_instanceRange);
+        _culler.destroy();
+        _geometryArena.destroy();
+        _meshes.clear();
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
             vkDestroySemaphore(_device, _imageAvailableSemaphores[i], nullptr);
             vkDestroySemaphore(_device, _renderFinishedSemaphores[i], nullptr);
             vkDestroyFence(_device, _inFlightFences[i], nullptr);
         }
-        vkDestroyCommandPool(_device, _commandPool, nullptr);
+        _uploadContext.destroy();
+        _transferContext.destroy();
+        for (auto commandPool : _commandPools) {
+            vkDestroyCommandPool(_device, commandPool, nullptr);
+        }
+        for (auto commandPool : _secondaryCommandPools) {
+            vkDestroyCommandPool(_device, commandPool, nullptr);
+        }
+        _pipelineCache.save();
+        _pipelineCache.destroy();
+        _profiler.destroy();
+        _allocator.destroy();
         vkDestroyDevice(_device, nullptr);
 #if ENABLE_VALIDATION_LAYERS
             DestroyDebugUtilsMessengerEXT(_instance, _debugMessenger, nullptr);
 #endif
-        vkDestroySurfaceKHR(_instance, _surface, nullptr);
+        if (_surface != VK_NULL_HANDLE)
+            vkDestroySurfaceKHR(_instance, _surface, nullptr);
         vkDestroyInstance(_instance, nullptr);
-        _window.destroy();
-        glfwTerminate();
+        if (!_options.headless) {
+            _window.destroy();
+            glfwTerminate();
+        }
 
-        _commandPool = VK_NULL_HANDLE;
+        _commandBuffers.clear();
+        _commandPools.clear();
+        _drawCommands.clear();
         _debugMessenger = VK_NULL_HANDLE;
+        _descriptorPool = VK_NULL_HANDLE;
+        _descriptorImageViews.clear();
+        _descriptorSets.clear();
         _descriptorSetLayout = VK_NULL_HANDLE;
         _device = VK_NULL_HANDLE;
+        _frameNumber = 0u;
         _imageAvailableSemaphores.clear();
-        _indexBuffer = VK_NULL_HANDLE;
-        _indexBufferMemory = VK_NULL_HANDLE;
+        _imagesInFlight.clear();
         _inFlightFences.clear();
         _instance = VK_NULL_HANDLE;
+        _graphicsPipeline = VK_NULL_HANDLE;
         _graphicsQueue = VK_NULL_HANDLE;
-        _mipLevels = 1u;
+        _meshRadius = 0.0f;
+        _placeholderImage = VK_NULL_HANDLE;
+        _placeholderImageAllocation = {};
+        _placeholderImageView = VK_NULL_HANDLE;
         _msaaSamples = VK_SAMPLE_COUNT_1_BIT;
         _physicalDevices.clear();
+        _pipelineLayout = VK_NULL_HANDLE;
+        _queueFamilyIndices = {};
         _renderFinishedSemaphores.clear();
+        _renderPass = VK_NULL_HANDLE;
+        _secondaryCommandBuffers.clear();
+        _secondaryCommandPools.clear();
         _surface = VK_NULL_HANDLE;
+        _swapchain = VK_NULL_HANDLE;
+        _textureBaseLevel = 0u;
+        _textureCompressionSupported = false;
+        _textureFile.reset();
         _textureImage = VK_NULL_HANDLE;
-        _textureImageMemory = VK_NULL_HANDLE;
+        _textureImageAllocation = {};
         _textureImageView = VK_NULL_HANDLE;
         _textureSampler = VK_NULL_HANDLE;
-        _vertexBuffer = VK_NULL_HANDLE;
-        _vertexBufferMemory = VK_NULL_HANDLE;
+        _transferQueue = VK_NULL_HANDLE;
+        _meshGeometries.clear();
+        _meshRadii.clear();
+        _instanceBatches.clear();
+        _instanceRange = {};
+        _scene = scene();
+        _sceneRadius = 0.0f;
+        _drawIndirectCountSupported = false;
+        _multiDrawIndirectSupported = false;
+        _vkCmdDrawIndexedIndirectCountKHR = nullptr;
         _window = scoped_glfw_window();
     }
 
     void hello_triangle_app::cleanupSwapchain() {
         vkDestroyImageView(_device, _colorImageView, nullptr);
         vkDestroyImage(_device, _colorImage, nullptr);
-        vkFreeMemory(_device, _colorImageMemory, nullptr);
+        _allocator.free(_colorImageAllocation);
         vkDestroyImageView(_device, _depthImageView, nullptr);
         vkDestroyImage(_device, _depthImage, nullptr);
-        vkFreeMemory(_device, _depthImageMemory, nullptr);
+        _allocator.free(_depthImageAllocation);
         for (auto framebuffer : _swapchainFramebuffers) {
             vkDestroyFramebuffer(_device, framebuffer, nullptr);
         }
-        vkFreeCommandBuffers(_device, _commandPool, static_cast<uint32_t>(_commandBuffers.size()), _commandBuffers.data());
-        vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
-        vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
-        vkDestroyRenderPass(_device, _renderPass, nullptr);
         for (const auto& imageView: _swapchainImageViews) {
             vkDestroyImageView(_device, imageView, nullptr);
         }
-        vkDestroySwapchainKHR(_device, _swapchain, nullptr);
-        for (size_t i = 0; i < _swapchainImages.size(); ++i) {
-            vkDestroyBuffer(_device, _uniformBuffers[i], nullptr);
-            vkFreeMemory(_device, _uniformBuffersMemory[i], nullptr);
+        if (!_offscreenImageAllocations.empty()) {
+            for (size_t i = 0; i < _swapchainImages.size(); ++i) {
+                vkDestroyImage(_device, _swapchainImages[i], nullptr);
+                _allocator.free(_offscreenImageAllocations[i]);
+            }
+            _swapchainImages.clear();
+        }
+        for (size_t i = 0; i < _readbackBuffers.size(); ++i) {
+            vkDestroyBuffer(_device, _readbackBuffers[i], nullptr);
+            _allocator.free(_readbackBufferAllocations[i]);
         }
-        vkDestroyDescriptorPool(_device, _descriptorPool, nullptr);
 
-        _commandBuffers.clear();
-        _descriptorPool = VK_NULL_HANDLE;
+        // the swapchain itself is retired by createSwapchain so it can be handed over as oldSwapchain
+        _colorImage = VK_NULL_HANDLE;
+        _colorImageView = VK_NULL_HANDLE;
+        _depthImage = VK_NULL_HANDLE;
+        _depthImageView = VK_NULL_HANDLE;
         _fullscreenToggleRequested = false;
         _framebufferResized = false;
-        _graphicsPipeline = VK_NULL_HANDLE;
-        _pipelineLayout = VK_NULL_HANDLE;
-        _renderPass = VK_NULL_HANDLE;
-        _swapchain = VK_NULL_HANDLE;
+        _offscreenImageAllocations.clear();
+        _readbackBufferAllocations.clear();
+        _readbackBuffers.clear();
         _swapchainFramebuffers.clear();
         _swapchainImageViews.clear();
-        _uniformBuffers.clear();
-        _uniformBuffersMemory.clear();
     }
 
-    void hello_triangle_app::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    void hello_triangle_app::copyBuffer(
+        VkBuffer srcBuffer,
+        VkDeviceSize srcOffset,
+        VkBuffer dstBuffer,
+        VkDeviceSize dstOffset,
+        VkDeviceSize size
+    ) {
+        VkCommandBuffer commandBuffer = _transferContext.getCommandBuffer();
 
         VkBufferCopy copyRegion = {};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1u, &copyRegion);
-
-        endSingleTimeCommands(commandBuffer);
     }
 
-    void hello_triangle_app::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkBufferImageCopy region = {};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0u;
-        region.bufferImageHeight = 0u;
-
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0u;
-        region.imageSubresource.baseArrayLayer = 0u;
-        region.imageSubresource.layerCount = 1u;
-
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {width, height, 1u};
-
-        vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1u, &region);
+    void hello_triangle_app::copyBufferToImage(
+        upload_context& context,
+        VkBuffer buffer,
+        VkImage image,
+        const std::vector<texture_level>& levels,
+        uint32_t firstMipLevel
+    ) {
+        std::vector<VkBufferImageCopy> regions(levels.size());
+        for (size_t i = 0; i < levels.size(); ++i) {
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = levels[i].offset;
+            region.bufferRowLength = 0u;
+            region.bufferImageHeight = 0u;
+
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = firstMipLevel + static_cast<uint32_t>(i);
+            region.imageSubresource.baseArrayLayer = 0u;
+            region.imageSubresource.layerCount = 1u;
+
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {levels[i].width, levels[i].height, 1u};
+        }
 
-        endSingleTimeCommands(commandBuffer);
+        vkCmdCopyBufferToImage(
+            context.getCommandBuffer(),
+            buffer,
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(regions.size()),
+            regions.data());
     }
 
     void hello_triangle_app::createBuffer(
@@ -505,7 +621,7 @@ namespace vulkan_tutorial {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory
+        device_allocation& bufferAllocation
     ) {
         VkBufferCreateInfo bufferInfo = {};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -520,16 +636,14 @@ namespace vulkan_tutorial {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(_device, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        bufferAllocation = _allocator.allocate(
+            memRequirements,
+            findMemoryType(memRequirements.memoryTypeBits, properties),
+            resource_kind::linear);
 
-        result = vkAllocateMemory(_device, &allocInfo, nullptr, &bufferMemory);
+        result = vkBindBufferMemory(_device, buffer, bufferAllocation.memory, bufferAllocation.offset);
         if (result != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate vertex buffer memory");
-
-        vkBindBufferMemory(_device, buffer, bufferMemory, 0);
+            throw std::runtime_error("failed to bind buffer memory");
     }
 
     void hello_triangle_app::createColorResources() {
@@ -545,11 +659,12 @@ namespace vulkan_tutorial {
             VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             _colorImage,
-            _colorImageMemory
+            _colorImageAllocation
         );
         _colorImageView = createImageView(_colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1u);
 
         transitionImageLayout(
+            _uploadContext,
             _colorImage,
             colorFormat,
             VK_IMAGE_LAYOUT_UNDEFINED,
@@ -559,73 +674,102 @@ namespace vulkan_tutorial {
     }
 
     void hello_triangle_app::createCommandBuffers() {
-        _commandBuffers.resize(_swapchainFramebuffers.size());
-
-        VkCommandBufferAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.commandPool = _commandPool;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandBufferCount = static_cast<uint32_t>(_commandBuffers.size());
-
-        VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, _commandBuffers.data());
-        if (result != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate command buffers");
+        _commandBuffers.resize(_commandPools.size());
 
-        for (size_t i = 0; i < _commandBuffers.size(); ++i) {
-            const auto& commandBuffer = _commandBuffers[i];
+        for (size_t i = 0; i < _commandPools.size(); ++i) {
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = _commandPools[i];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1u;
 
-            VkCommandBufferBeginInfo beginInfo = {};
-            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            beginInfo.flags = 0u;
-            beginInfo.pInheritanceInfo = nullptr;
-
-            VkResult beginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
-            if (beginResult != VK_SUCCESS)
-                throw std::runtime_error("failed to begin recording command buffer");
-
-            std::array<VkClearValue, 2> clearValues = {};
-            clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
-            clearValues[1].depthStencil = {1.0f, 0u};
+            VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &_commandBuffers[i]);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate command buffers");
+        }
 
-            VkRenderPassBeginInfo renderPassInfo = {};
-            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-            renderPassInfo.renderPass = _renderPass;
-            renderPassInfo.framebuffer = _swapchainFramebuffers[i];
-            renderPassInfo.renderArea.offset = { 0, 0 };
-            renderPassInfo.renderArea.extent = _swapchainExtent;
-            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-            renderPassInfo.pClearValues = clearValues.data();
+        _secondaryCommandBuffers.resize(_secondaryCommandPools.size());
 
-            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
-            VkBuffer vertexBuffers[] = {_vertexBuffer};
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0u, 1u, vertexBuffers, offsets);
-            vkCmdBindIndexBuffer(commandBuffer, _indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-            vkCmdBindDescriptorSets(
-                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
-                0u, 1u, &_descriptorSets[i],
-                0u, nullptr);
-            vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(_indices.size()), 1u, 0u, 0u, 0u);
-            vkCmdEndRenderPass(commandBuffer);
+        for (size_t i = 0; i < _secondaryCommandPools.size(); ++i) {
+            VkCommandBufferAllocateInfo allocInfo = {};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = _secondaryCommandPools[i];
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1u;
 
-            VkResult endResult = vkEndCommandBuffer(commandBuffer);
-            if (endResult != VK_SUCCESS)
-                throw std::runtime_error("failed to record command buffer");
+            VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &_secondaryCommandBuffers[i]);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to allocate secondary command buffers");
         }
     }
 
     void hello_triangle_app::createCommandPool() {
         queue_family_indices queueFamilyIndices = findQueueFamilies();
 
+        // One pool per frame in flight, reset as a whole once the frame's fence has signalled. Resetting the pool
+        // is cheaper than resetting individual command buffers and lets the driver recycle its memory.
         VkCommandPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-        poolInfo.flags = 0u;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-        VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPool);
-        if (result != VK_SUCCESS)
-            throw std::runtime_error("failed to create command pool");
+        _commandPools.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_commandPools[i]);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to create command pool");
+        }
+
+        // secondary command buffers are recorded concurrently, so every recording job gets its own pool per frame
+        _secondaryCommandPools.resize(MAX_FRAMES_IN_FLIGHT * _jobs.getThreadCount());
+        for (size_t i = 0; i < _secondaryCommandPools.size(); ++i) {
+            VkResult result = vkCreateCommandPool(_device, &poolInfo, nullptr, &_secondaryCommandPools[i]);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to create secondary command pool");
+        }
+
+        _uploadContext.init(_device, _graphicsQueue, queueFamilyIndices.graphicsFamily.value(), &_allocator);
+        _transferContext.init(
+            _device,
+            _transferQueue,
+            _queueFamilyIndices.transferFamily.value_or(queueFamilyIndices.graphicsFamily.value()),
+            &_allocator);
+    }
+
+    void hello_triangle_app::createCuller() {
+        std::vector<cull_batch> batches;
+        std::vector<VkDrawIndexedIndirectCommand> draws;
+        for (const auto& batch : _instanceBatches) {
+            const auto& geometry = _meshGeometries[batch.mesh];
+
+            cull_batch cullBatch = {};
+            cullBatch.firstInstance = batch.firstInstance;
+            cullBatch.instanceCount = batch.instanceCount;
+            cullBatch.radius = _meshRadii[batch.mesh];
+            cullBatch.firstDraw = static_cast<uint32_t>(draws.size());
+            cullBatch.drawCount = static_cast<uint32_t>(geometry.subMeshes.size());
+            batches.push_back(cullBatch);
+
+            for (const auto& subMesh : geometry.subMeshes) {
+                VkDrawIndexedIndirectCommand draw = {};
+                draw.indexCount = subMesh.indexCount;
+                draw.firstIndex = subMesh.firstIndex;
+                draw.vertexOffset = subMesh.vertexOffset;
+                draws.push_back(draw);
+            }
+        }
+
+        _culler.init(
+            _physicalDevices[0],
+            _device,
+            &_allocator,
+            _pipelineCache.get(),
+            _cullShaderCode,
+            MAX_FRAMES_IN_FLIGHT,
+            _geometryArena.getBuffer(),
+            _instanceRange.offset,
+            std::move(batches),
+            draws);
     }
 
     void hello_triangle_app::createDepthResources() {
@@ -643,11 +787,12 @@ namespace vulkan_tutorial {
             VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             _depthImage,
-            _depthImageMemory
+            _depthImageAllocation
         );
         _depthImageView = createImageView(_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1u);
 
         transitionImageLayout(
+            _uploadContext,
             _depthImage,
             depthFormat,
             VK_IMAGE_LAYOUT_UNDEFINED,
@@ -658,16 +803,16 @@ namespace vulkan_tutorial {
 
     void hello_triangle_app::createDescriptorPool() {
         std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        poolSizes[0].descriptorCount = static_cast<uint32_t>(_swapchainImages.size());
+        poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
         poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        poolSizes[1].descriptorCount = static_cast<uint32_t>(_swapchainImages.size());
+        poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
         VkDescriptorPoolCreateInfo poolInfo = {};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
         poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = static_cast<uint32_t>(_swapchainImages.size());
+        poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
 
         VkResult result = vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_descriptorPool);
         if (result != VK_SUCCESS)
@@ -684,7 +829,7 @@ namespace vulkan_tutorial {
 
         VkDescriptorSetLayoutBinding uboLayoutBinding = {};
         uboLayoutBinding.binding = 0u;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         uboLayoutBinding.descriptorCount = 1u;
         uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         uboLayoutBinding.pImmutableSamplers = nullptr;
@@ -702,55 +847,41 @@ namespace vulkan_tutorial {
     }
 
     void hello_triangle_app::createDescriptorSets() {
-        std::vector<VkDescriptorSetLayout> layouts(_swapchainImages.size(), _descriptorSetLayout);
+        std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, _descriptorSetLayout);
+
         VkDescriptorSetAllocateInfo allocInfo = {};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocInfo.descriptorPool = _descriptorPool;
-        allocInfo.descriptorSetCount = static_cast<uint32_t>(_swapchainImages.size());
+        allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
         allocInfo.pSetLayouts = layouts.data();
 
-        _descriptorSets.resize(_swapchainImages.size());
+        _descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
         VkResult result = vkAllocateDescriptorSets(_device, &allocInfo, _descriptorSets.data());
         if (result != VK_SUCCESS)
             throw std::runtime_error("failed to allocate descriptor");
 
-        for (size_t i = 0; i < _swapchainImages.size(); ++i) {
-            VkDescriptorBufferInfo bufferInfo = {};
-            bufferInfo.buffer = _uniformBuffers[i];
-            bufferInfo.offset = 0;
-            bufferInfo.range = sizeof(uniform_buffer_object);
-
-            VkDescriptorImageInfo imageInfo = {};
-            imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            imageInfo.imageView = _textureImageView;
-            imageInfo.sampler = _textureSampler;
-
-            std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
-
-            descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[0].dstSet = _descriptorSets[i];
-            descriptorWrites[0].dstBinding = 0u;
-            descriptorWrites[0].dstArrayElement = 0u;
-            descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            descriptorWrites[0].descriptorCount = 1u;
-            descriptorWrites[0].pBufferInfo = &bufferInfo;
-            descriptorWrites[0].pImageInfo = nullptr;
-            descriptorWrites[0].pTexelBufferView = nullptr;
-
-            descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptorWrites[1].dstSet = _descriptorSets[i];
-            descriptorWrites[1].dstBinding = 1u;
-            descriptorWrites[1].dstArrayElement = 0u;
-            descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            descriptorWrites[1].descriptorCount = 1u;
-            descriptorWrites[1].pBufferInfo = nullptr;
-            descriptorWrites[1].pImageInfo = &imageInfo;
-            descriptorWrites[1].pTexelBufferView = nullptr;
-
-            vkUpdateDescriptorSets(
-                _device,
-                static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(),
-                0u, nullptr);
+        // the uniform data of every frame lives in the same ring buffer, selected by a dynamic offset at bind time
+        VkDescriptorBufferInfo bufferInfo = {};
+        bufferInfo.buffer = _uniformRing.getBuffer();
+        bufferInfo.offset = 0;
+        bufferInfo.range = sizeof(uniform_buffer_object);
+
+        _descriptorImageViews.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+        for (uint32_t i = 0u; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            VkWriteDescriptorSet descriptorWrite = {};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = _descriptorSets[i];
+            descriptorWrite.dstBinding = 0u;
+            descriptorWrite.dstArrayElement = 0u;
+            descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            descriptorWrite.descriptorCount = 1u;
+            descriptorWrite.pBufferInfo = &bufferInfo;
+            descriptorWrite.pImageInfo = nullptr;
+            descriptorWrite.pTexelBufferView = nullptr;
+
+            vkUpdateDescriptorSets(_device, 1u, &descriptorWrite, 0u, nullptr);
+
+            updateTextureDescriptor(i);
         }
     }
 
@@ -780,19 +911,14 @@ namespace vulkan_tutorial {
     }
 
     void hello_triangle_app::createGraphicsPipeline() {
-        auto fragShaderCode = readFile("psmain.spv");
-        std::cout << "read psmain.spv (" << fragShaderCode.size() << " bytes)" << std::endl;
-        auto vertShaderCode = readFile("vsmain.spv");
-        std::cout << "read vsmain.spv (" << vertShaderCode.size() << " bytes)" << std::endl;
-
-        VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+        VkShaderModule fragShaderModule = createShaderModule(_fragmentShaderCode);
         VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
         fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
         fragShaderStageInfo.module = fragShaderModule;
         fragShaderStageInfo.pName = "main";
 
-        VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+        VkShaderModule vertShaderModule = createShaderModule(_vertexShaderCode);
         VkPipelineShaderStageCreateInfo vertShaderStageInfo = {};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -801,13 +927,24 @@ namespace vulkan_tutorial {
 
         VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-        auto attributeDescriptions = vertex::getAttributeDescriptions();
-        auto bindingDescription = vertex::getBindingDescription();
+        auto vertexAttributeDescriptions = _options.compactVertices
+            ? compact_vertex::getAttributeDescriptions()
+            : vertex::getAttributeDescriptions();
+        auto instanceAttributeDescriptions = instance_data::getAttributeDescriptions();
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(
+            vertexAttributeDescriptions.begin(), vertexAttributeDescriptions.end());
+        attributeDescriptions.insert(
+            attributeDescriptions.end(), instanceAttributeDescriptions.begin(), instanceAttributeDescriptions.end());
+
+        std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+            _options.compactVertices ? compact_vertex::getBindingDescription() : vertex::getBindingDescription(),
+            instance_data::getBindingDescription()
+        };
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexBindingDescriptionCount = 1u;
-        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
         vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
         vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -816,24 +953,23 @@ namespace vulkan_tutorial {
         inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-        VkViewport viewport = {};
-        viewport.x = 0.0f;
-        viewport.y = 0.0f;
-        viewport.width = (float) _swapchainExtent.width;
-        viewport.height = (float) _swapchainExtent.height;
-        viewport.minDepth = 0.0f;
-        viewport.maxDepth = 1.0;
-
-        VkRect2D scissor = {};
-        scissor.offset = { 0, 0 };
-        scissor.extent = _swapchainExtent;
-
+        // viewport and scissor are set while recording so the pipeline survives a resize
         VkPipelineViewportStateCreateInfo viewportState = {};
         viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
         viewportState.viewportCount = 1u;
-        viewportState.pViewports = &viewport;
+        viewportState.pViewports = nullptr;
         viewportState.scissorCount = 1u;
-        viewportState.pScissors = &scissor;
+        viewportState.pScissors = nullptr;
+
+        std::array<VkDynamicState, 2> dynamicStates = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState = {};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+        dynamicState.pDynamicStates = dynamicStates.data();
 
         VkPipelineRasterizationStateCreateInfo rasterizer = {};
         rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -916,14 +1052,14 @@ namespace vulkan_tutorial {
         pipelineInfo.pMultisampleState = &multisampling;
         pipelineInfo.pDepthStencilState = &depthStencil;
         pipelineInfo.pColorBlendState = &colorBlending;
-        pipelineInfo.pDynamicState = nullptr;
+        pipelineInfo.pDynamicState = &dynamicState;
         pipelineInfo.layout = _pipelineLayout;
         pipelineInfo.renderPass = _renderPass;
         pipelineInfo.subpass = 0u;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
         pipelineInfo.basePipelineIndex = -1;
 
-        result = vkCreateGraphicsPipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline);
+        result = vkCreateGraphicsPipelines(_device, _pipelineCache.get(), 1, &pipelineInfo, nullptr, &_graphicsPipeline);
         if (result != VK_SUCCESS)
             throw std::runtime_error("failed to create graphics pipeline");
 
@@ -934,7 +1070,7 @@ namespace vulkan_tutorial {
     void hello_triangle_app::createImage(
         uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format,
         VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-        VkImage& image, VkDeviceMemory& imageMemory
+        VkImage& image, device_allocation& imageAllocation
     ) {
         VkImageCreateInfo imageInfo = {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -959,16 +1095,14 @@ namespace vulkan_tutorial {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(_device, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo = {};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        imageAllocation = _allocator.allocate(
+            memRequirements,
+            findMemoryType(memRequirements.memoryTypeBits, properties),
+            tiling == VK_IMAGE_TILING_OPTIMAL ? resource_kind::optimal : resource_kind::linear);
 
-        result = vkAllocateMemory(_device, &allocInfo, nullptr, &imageMemory);
+        result = vkBindImageMemory(_device, image, imageAllocation.memory, imageAllocation.offset);
         if (result != VK_SUCCESS)
-            throw std::runtime_error("failed to allocate image memory");
-
-        vkBindImageMemory(_device, image, imageMemory, 0);
+            throw std::runtime_error("failed to bind image memory");
     }
 
     VkImageView hello_triangle_app::createImageView(
@@ -1014,36 +1148,8 @@ namespace vulkan_tutorial {
         }
     }
 
-    void hello_triangle_app::createIndexBuffer() {
-        VkDeviceSize bufferSize = sizeof(_indices[0]) * _indices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory
-        );
-
-        void* data;
-        vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, _indices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(_device, stagingBufferMemory);
-
-        createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            _indexBuffer,
-            _indexBufferMemory
-        );
-
-        copyBuffer(stagingBuffer, _indexBuffer, bufferSize);
-
-        vkDestroyBuffer(_device, stagingBuffer, nullptr);
-        vkFreeMemory(_device, stagingBufferMemory, nullptr);
+    void hello_triangle_app::createGeometryArena() {
+        _geometryArena.init(_device, &_allocator, GEOMETRY_ARENA_SIZE);
     }
 
     void hello_triangle_app::createInstance() {
@@ -1094,6 +1200,8 @@ namespace vulkan_tutorial {
             indices.graphicsFamily.value(),
             indices.presentFamily.value()
         };
+        if (indices.transferFamily.has_value())
+            uniqueQueueFamilies.insert(indices.transferFamily.value());
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -1105,17 +1213,33 @@ namespace vulkan_tutorial {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(_physicalDevices[0], &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         deviceFeatures.sampleRateShading = VK_TRUE;
+        deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+        // GPU culling issues all of a mesh's sub-mesh draws with one indirect call where it can, and skips meshes
+        // without visible instances where the draw count can come from a buffer
+        std::vector<const char*> deviceExtensions = _deviceExtensions;
+        bool drawIndirectCountSupported = false;
+        if (_options.gpuCulling) {
+            deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+            drawIndirectCountSupported = isDeviceExtensionAvailable(
+                _physicalDevices[0], VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+            if (drawIndirectCountSupported)
+                deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        }
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(_deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = _deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
         VkDeviceGroupDeviceCreateInfo groupCreateInfo = {};
         groupCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_GROUP_DEVICE_CREATE_INFO;
@@ -1138,6 +1262,97 @@ namespace vulkan_tutorial {
 
         vkGetDeviceQueue(_device, indices.graphicsFamily.value(), 0u, &_graphicsQueue);
         vkGetDeviceQueue(_device, indices.presentFamily.value(), 0u, &_presentQueue);
+        if (indices.transferFamily.has_value()) {
+            vkGetDeviceQueue(_device, indices.transferFamily.value(), 0u, &_transferQueue);
+            std::cout << "using dedicated transfer queue family #" << indices.transferFamily.value() << std::endl;
+        }
+        else {
+            _transferQueue = _graphicsQueue;
+            std::cout << "no dedicated transfer queue family, uploading on the graphics queue" << std::endl;
+        }
+        _queueFamilyIndices = indices;
+        _textureCompressionSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+        _multiDrawIndirectSupported = deviceFeatures.multiDrawIndirect == VK_TRUE;
+        _drawIndirectCountSupported = drawIndirectCountSupported;
+        if (_drawIndirectCountSupported) {
+            _vkCmdDrawIndexedIndirectCountKHR = (PFN_vkCmdDrawIndexedIndirectCountKHR) vkGetDeviceProcAddr(
+                _device, "vkCmdDrawIndexedIndirectCountKHR");
+        }
+        if (_options.gpuCulling) {
+            std::cout << "GPU culling with " << (_drawIndirectCountSupported ? "indirect count draws"
+                : _multiDrawIndirectSupported ? "multi-draw indirect" : "one indirect draw per sub-mesh") << std::endl;
+        }
+
+        _allocator.init(_physicalDevices[0], _device);
+        _pipelineCache.init(_physicalDevices[0], _device, PIPELINE_CACHE_PATH);
+        _profiler.init(
+            _physicalDevices[0],
+            _device,
+            indices.graphicsFamily.value(),
+            MAX_FRAMES_IN_FLIGHT,
+            !_options.tracePath.empty());
+        _textureLoader.init(_device, &_allocator, _textureCompressionSupported);
+    }
+
+    void hello_triangle_app::createOffscreenTargets() {
+        // R8G8B8A8 can be written out as is, and every implementation supports it as a color attachment
+        _swapchainExtent = { static_cast<uint32_t>(INITIAL_WIDTH), static_cast<uint32_t>(INITIAL_HEIGHT) };
+        _swapchainImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+        _swapchainImages.resize(MAX_FRAMES_IN_FLIGHT);
+        _offscreenImageAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            createImage(
+                _swapchainExtent.width,
+                _swapchainExtent.height,
+                1u,
+                VK_SAMPLE_COUNT_1_BIT,
+                _swapchainImageFormat,
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                _swapchainImages[i],
+                _offscreenImageAllocations[i]
+            );
+        }
+        _imagesInFlight.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+
+        if (_options.readbackPath.empty())
+            return;
+
+        _readbackBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+        _readbackBufferAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+            createBuffer(
+                static_cast<VkDeviceSize>(_swapchainExtent.width) * _swapchainExtent.height * 4u,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                _readbackBuffers[i],
+                _readbackBufferAllocations[i]
+            );
+        }
+    }
+
+    void hello_triangle_app::createPlaceholderTexture() {
+        loaded_texture texture = {};
+        texture.path = "placeholder";
+        texture.format = VK_FORMAT_R8G8B8A8_UNORM;
+        texture.width = 1u;
+        texture.height = 1u;
+        texture.levels.push_back(texture_level { 1u, 1u, 0u, 4u });
+
+        createBuffer(
+            texture.levels[0].size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            texture.stagingBuffer,
+            texture.stagingAllocation);
+
+        const uint8_t grey[] = { 128u, 128u, 128u, 255u };
+        memcpy(texture.stagingAllocation.mapped, grey, sizeof(grey));
+
+        uploadTexture(texture, _placeholderImage, _placeholderImageAllocation);
+        _placeholderImageView = createImageView(_placeholderImage, texture.format, VK_IMAGE_ASPECT_COLOR_BIT, 1u);
     }
 
     void hello_triangle_app::createRenderPass() {
@@ -1181,7 +1396,9 @@ namespace vulkan_tutorial {
         colorAttachmentResolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachmentResolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachmentResolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachmentResolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachmentResolve.finalLayout = _options.headless
+            ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+            : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentResolveRef = {};
         colorAttachmentResolveRef.attachment = 2u;
@@ -1194,15 +1411,23 @@ namespace vulkan_tutorial {
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
         subpass.pResolveAttachments = &colorAttachmentResolveRef;
 
-        VkSubpassDependency dependency = {};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0u;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.srcAccessMask = 0u;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+        std::array<VkSubpassDependency, 2> dependencies = {};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0u;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].srcAccessMask = 0u;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
             | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
+        // headless frames may be copied out to a readback buffer right after the render pass
+        dependencies[1].srcSubpass = 0u;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
         std::array<VkAttachmentDescription, 3> attachments = {
             colorAttachment,
             depthAttachment,
@@ -1214,8 +1439,8 @@ namespace vulkan_tutorial {
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1u;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1u;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = _options.headless ? 2u : 1u;
+        renderPassInfo.pDependencies = dependencies.data();
 
         VkResult result = vkCreateRenderPass(_device, &renderPassInfo, nullptr, &_renderPass);
         if (result != VK_SUCCESS)
@@ -1277,8 +1502,8 @@ namespace vulkan_tutorial {
         VkPresentModeKHR presentMode = chooseSwapPresentMode(swapchainSupport.presentModes);
         VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapchainSupport.formats);
 
-        // uint32_t imageCount = swapchainSupport.capabilities.maxImageCount;
-        uint32_t imageCount = swapchainSupport.capabilities.minImageCount;
+        // one image more than the minimum so acquiring doesn't have to wait for the presentation engine
+        uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1u;
         if (swapchainSupport.capabilities.maxImageCount > 0u
             && imageCount > swapchainSupport.capabilities.maxImageCount
         ) {
@@ -1316,98 +1541,32 @@ namespace vulkan_tutorial {
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
         createInfo.presentMode = presentMode;
         createInfo.clipped = true;
-        createInfo.oldSwapchain = VK_NULL_HANDLE;
+        createInfo.oldSwapchain = _swapchain;
 
-        VkResult result = vkCreateSwapchainKHR(_device, &createInfo, nullptr, &_swapchain);
+        VkSwapchainKHR swapchain;
+        VkResult result = vkCreateSwapchainKHR(_device, &createInfo, nullptr, &swapchain);
         if (result != VK_SUCCESS)
             throw std::runtime_error("failed to create the swapchain");
 
+        vkDestroySwapchainKHR(_device, _swapchain, nullptr);
+        _swapchain = swapchain;
+
         vkGetSwapchainImagesKHR(_device, _swapchain, &imageCount, nullptr);
         _swapchainImages.resize(imageCount);
         vkGetSwapchainImagesKHR(_device, _swapchain, &imageCount, _swapchainImages.data());
+        _imagesInFlight.assign(imageCount, VK_NULL_HANDLE);
 
         _swapchainExtent = extent;
         _swapchainImageFormat = surfaceFormat.format;
     }
 
     void hello_triangle_app::createUniformBuffers() {
-        VkDeviceSize bufferSize = sizeof(uniform_buffer_object);
-
-        _uniformBuffers.resize(_swapchainImages.size());
-        _uniformBuffersMemory.resize(_swapchainImages.size());
-
-        for (size_t i = 0; i < _swapchainImages.size(); ++i) {
-            createBuffer(
-                bufferSize,
-                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                _uniformBuffers[i],
-                _uniformBuffersMemory[i]
-            );
-        }
-    }
-
-    void hello_triangle_app::createTextureImage() {
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(TEXTURE_PATH.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-        if (pixels == nullptr)
-            throw std::runtime_error("failed to load texture image");
-
-        VkDeviceSize imageSize = texWidth * texHeight * 4;
-        _mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1u;
-
-        std::cout << "read " << TEXTURE_PATH << ": "
-            << texWidth << 'x' << texHeight << 'x' << texChannels
-            << " (" << _mipLevels << " mips)"
-            << std::endl;
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(
-            imageSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory);
-
-        void* data;
-        vkMapMemory(_device, stagingBufferMemory, 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(_device, stagingBufferMemory);
-
-        stbi_image_free(pixels);
-
-        createImage(
-            texWidth, texHeight, _mipLevels,
-            VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            _textureImage, _textureImageMemory
-        );
-        transitionImageLayout(
-            _textureImage,
-            VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_LAYOUT_UNDEFINED,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            _mipLevels
-        );
-        copyBufferToImage(stagingBuffer, _textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-        // transitioned to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL while generating mipmaps
-
-        generateMipmaps(_textureImage, VK_FORMAT_R8G8B8A8_UNORM, texWidth, texHeight, _mipLevels);
-
-        vkDestroyBuffer(_device, stagingBuffer, nullptr);
-        vkFreeMemory(_device, stagingBufferMemory, nullptr);
-    }
-
-    void hello_triangle_app::createTextureImageView() {
-        _textureImageView = createImageView(
-            _textureImage,
-            VK_FORMAT_R8G8B8A8_UNORM,
-            VK_IMAGE_ASPECT_COLOR_BIT,
-            _mipLevels);
+        _uniformRing.init(
+            _physicalDevices[0],
+            _device,
+            &_allocator,
+            UNIFORM_RING_FRAME_SIZE * MAX_FRAMES_IN_FLIGHT,
+            MAX_FRAMES_IN_FLIGHT);
     }
 
     void hello_triangle_app::createTextureSampler() {
@@ -1427,43 +1586,14 @@ namespace vulkan_tutorial {
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.mipLodBias = 0.0f;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>(_mipLevels);
+        // textures stream in after the sampler is created, so don't limit it to the current mip count
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
         VkResult result = vkCreateSampler(_device, &samplerInfo, nullptr, &_textureSampler);
         if (result != VK_SUCCESS)
             throw std::runtime_error("failed to create texture sampler");
     }
 
-    void hello_triangle_app::createVertexBuffer() {
-        VkDeviceSize bufferSize = sizeof(_vertices[0]) * _vertices.size();
-
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            stagingBuffer,
-            stagingBufferMemory
-        );
-        void* data;
-        vkMapMemory(_device, stagingBufferMemory, 0, bufferSize, 0, &data);
-        memcpy(data, _vertices.data(), static_cast<size_t>(bufferSize));
-        vkUnmapMemory(_device, stagingBufferMemory);
-
-        createBuffer(
-            bufferSize,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            _vertexBuffer,
-            _vertexBufferMemory
-        );
-        copyBuffer(stagingBuffer, _vertexBuffer, bufferSize);
-
-        vkDestroyBuffer(_device, stagingBuffer, nullptr);
-        vkFreeMemory(_device, stagingBufferMemory, nullptr);
-    }
-
     VKAPI_ATTR VkBool32 VKAPI_CALL hello_triangle_app::debugCallback(
         VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
         VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -1479,88 +1609,159 @@ namespace vulkan_tutorial {
         app->_framebufferResized = true;
     }
 
+    void hello_triangle_app::destroyRetiredTextures(bool force) {
+        auto retired = _retiredTextures.begin();
+        while (retired != _retiredTextures.end()) {
+            // by then every frame in flight has rebound its descriptor set to the replacement
+            bool unused = retired->frameNumber + MAX_FRAMES_IN_FLIGHT <= _frameNumber
+                && retired->uploadTicket != 0u
+                && _uploadContext.isComplete(retired->uploadTicket);
+            if (!force && !unused) {
+                ++retired;
+                continue;
+            }
+
+            vkDestroyImageView(_device, retired->view, nullptr);
+            vkDestroyImage(_device, retired->image, nullptr);
+            _allocator.free(retired->allocation);
+            retired = _retiredTextures.erase(retired);
+        }
+    }
+
     void hello_triangle_app::drawFrame() {
-        vkWaitForFences(_device, 1u, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
+        _profiler.beginFrame();
 
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(
-            _device,
-            _swapchain,
-            UINT64_MAX,
-            _imageAvailableSemaphores[_currentFrame],
-            VK_NULL_HANDLE,
-            &imageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            recreateSwapchain();
-            return;
+        {
+            profiler::scope scope(_profiler, "wait for frame");
+            vkWaitForFences(_device, 1u, &_inFlightFences[_currentFrame], VK_TRUE, UINT64_MAX);
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error("failed to acquired swapchain image");
+        _profiler.collectGpuTimes(_currentFrame);
+
+        // headless, every frame in flight renders to its own offscreen image
+        uint32_t imageIndex = _currentFrame;
+        VkResult result = VK_SUCCESS;
+        if (!_options.headless) {
+            profiler::scope scope(_profiler, "acquire");
+            result = vkAcquireNextImageKHR(
+                _device,
+                _swapchain,
+                UINT64_MAX,
+                _imageAvailableSemaphores[_currentFrame],
+                VK_NULL_HANDLE,
+                &imageIndex);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                recreateSwapchain();
+                return;
+            }
+            else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("failed to acquired swapchain image");
+            }
         }
 
-        updateUniformBuffer(imageIndex);
+        // The swapchain may hand out images out of order, or more images than frames in flight, so also wait on
+        // whichever frame last rendered to this image before rendering to it again.
+        if (_imagesInFlight[imageIndex] != VK_NULL_HANDLE
+            && _imagesInFlight[imageIndex] != _inFlightFences[_currentFrame]
+        ) {
+            vkWaitForFences(_device, 1u, &_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        }
+        _imagesInFlight[imageIndex] = _inFlightFences[_currentFrame];
 
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        {
+            profiler::scope scope(_profiler, "texture streaming");
+            pollTextures();
+            streamTextures();
+            updateTextureDescriptor(_currentFrame);
+        }
 
-        VkSemaphore waitSemaphores[] = { _imageAvailableSemaphores[_currentFrame] };
-        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        submitInfo.waitSemaphoreCount = 1u;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
+        {
+            profiler::scope scope(_profiler, "uniform update");
+            _uniformRing.beginFrame(_currentFrame);
+
+            // every repetition of a mesh is drawn by the same instanced draws
+            _drawCommands.clear();
+            for (const auto& batch : _instanceBatches) {
+                const auto& geometry = _meshGeometries[batch.mesh];
+                uint32_t uniformOffset = updateUniformBuffer(geometry);
+                for (const auto& subMesh : geometry.subMeshes) {
+                    draw_command draw = {};
+                    draw.indexType = geometry.indexType;
+                    draw.indexCount = subMesh.indexCount;
+                    draw.firstIndex = subMesh.firstIndex;
+                    draw.vertexOffset = subMesh.vertexOffset;
+                    draw.instanceCount = batch.instanceCount;
+                    draw.firstInstance = batch.firstInstance;
+                    draw.uniformOffset = uniformOffset;
+                    _drawCommands.push_back(draw);
+                }
+            }
+        }
+
+        auto recordStartTime = std::chrono::high_resolution_clock::now();
+        VkCommandBuffer commandBuffer = _commandBuffers[_currentFrame];
+        {
+            profiler::scope scope(_profiler, "record");
+            vkResetCommandPool(_device, _commandPools[_currentFrame], 0u);
+            recordCommandBuffer(commandBuffer, imageIndex);
+        }
+        _commandRecordingTime += std::chrono::high_resolution_clock::now() - recordStartTime;
+        ++_recordedCommandBuffers;
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+        VkSemaphore waitSemaphores[] = { _imageAvailableSemaphores[_currentFrame] };
+        VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        submitInfo.waitSemaphoreCount = _options.headless ? 0u : 1u;
+        submitInfo.pWaitSemaphores = waitSemaphores;
+        submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1u;
-        submitInfo.pCommandBuffers = &_commandBuffers[imageIndex];
+        submitInfo.pCommandBuffers = &commandBuffer;
 
         VkSemaphore signalSemaphores[] = { _renderFinishedSemaphores[_currentFrame] };
-        submitInfo.signalSemaphoreCount = 1u;
+        submitInfo.signalSemaphoreCount = _options.headless ? 0u : 1u;
         submitInfo.pSignalSemaphores = signalSemaphores;
 
         vkResetFences(_device, 1u, &_inFlightFences[_currentFrame]);
 
-        result = vkQueueSubmit(_graphicsQueue, 1u, &submitInfo, _inFlightFences[_currentFrame]);
-        if (result != VK_SUCCESS)
-            throw std::runtime_error("failed to submit draw command buffer");
-
-        VkPresentInfoKHR presentInfo = {};
-        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-        presentInfo.waitSemaphoreCount = 1u;
-        presentInfo.pWaitSemaphores = signalSemaphores;
-
-        VkSwapchainKHR swapchains[] = { _swapchain };
-        presentInfo.swapchainCount = 1u;
-        presentInfo.pSwapchains = swapchains;
-        presentInfo.pImageIndices = &imageIndex;
-        presentInfo.pResults = nullptr;
-
-        result = vkQueuePresentKHR(_presentQueue, &presentInfo);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR
-            || result == VK_SUBOPTIMAL_KHR
-            || _framebufferResized
-            || _fullscreenToggleRequested
-        ) {
-            recreateSwapchain();
+        {
+            profiler::scope scope(_profiler, "submit");
+            result = vkQueueSubmit(_graphicsQueue, 1u, &submitInfo, _inFlightFences[_currentFrame]);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to submit draw command buffer");
         }
-        else if (result != VK_SUCCESS) {
-            throw std::runtime_error("failed to present swap chain image");
+
+        if (!_options.headless) {
+            profiler::scope scope(_profiler, "present");
+            VkPresentInfoKHR presentInfo = {};
+            presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+            presentInfo.waitSemaphoreCount = 1u;
+            presentInfo.pWaitSemaphores = signalSemaphores;
+
+            VkSwapchainKHR swapchains[] = { _swapchain };
+            presentInfo.swapchainCount = 1u;
+            presentInfo.pSwapchains = swapchains;
+            presentInfo.pImageIndices = &imageIndex;
+            presentInfo.pResults = nullptr;
+
+            result = vkQueuePresentKHR(_presentQueue, &presentInfo);
+            if (result == VK_ERROR_OUT_OF_DATE_KHR
+                || result == VK_SUBOPTIMAL_KHR
+                || _framebufferResized
+                || _fullscreenToggleRequested
+            ) {
+                recreateSwapchain();
+            }
+            else if (result != VK_SUCCESS) {
+                throw std::runtime_error("failed to present swap chain image");
+            }
         }
 
-        vkQueueWaitIdle(_presentQueue);
+        if (_options.serializeFrames)
+            vkQueueWaitIdle(_presentQueue);
 
         _currentFrame = (_currentFrame + 1u) % MAX_FRAMES_IN_FLIGHT;
-    }
-
-    void hello_triangle_app::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-        vkEndCommandBuffer(commandBuffer);
-
-        VkSubmitInfo submitInfo = {};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1u;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(_graphicsQueue, 1u, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(_graphicsQueue);
-
-        vkFreeCommandBuffers(_device, _commandPool, 1u, &commandBuffer);
+        ++_frameNumber;
     }
 
     VkFormat hello_triangle_app::findDepthFormat() const {
@@ -1577,19 +1778,14 @@ namespace vulkan_tutorial {
         );
     }
 
-    uint32_t hello_triangle_app::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(_physicalDevices[0], &memProperties);
-
-        for (uint32_t i = 0u; i < memProperties.memoryTypeCount; ++i) {
-            bool matchesFilter = (typeFilter & (1 << i)) != 0u;
-            bool hasProperties = (memProperties.memoryTypes[i].propertyFlags & properties) == properties;
-            if (matchesFilter && hasProperties) {
-                return i;
-            }
-        }
+    uint64_t hello_triangle_app::flushUploads() {
+        // The graphics batch waits on the transfer batch, so its ticket covers both.
+        _transferContext.flush(&_uploadContext);
+        return _uploadContext.flush();
+    }
 
-        throw std::runtime_error("failed to find a suitable memory type");
+    uint32_t hello_triangle_app::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        return _allocator.findMemoryType(typeFilter, properties);
     }
 
     VkFormat hello_triangle_app::findSupportedFormat(
@@ -1635,8 +1831,12 @@ namespace vulkan_tutorial {
                 indices.graphicsFamily = i;
             }
 
+            // headless frames are never presented, the graphics queue stands in for the present queue
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _surface, &presentSupport);
+            if (_options.headless)
+                presentSupport = indices.graphicsFamily == static_cast<uint32_t>(i);
+            else
+                vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, _surface, &presentSupport);
             if (queueFamily.queueCount > 0 && presentSupport) {
                 indices.presentFamily = i;
             }
@@ -1646,6 +1846,24 @@ namespace vulkan_tutorial {
             }
         }
 
+        // Prefer a pure DMA family, then any transfer capable family that can't do graphics.
+        for (int i = 0; i < queueFamilies.size(); ++i) {
+            const auto& queueFamily = queueFamilies[i];
+            if (queueFamily.queueCount == 0
+                || (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) != VK_QUEUE_TRANSFER_BIT
+                || (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) == VK_QUEUE_GRAPHICS_BIT)
+            {
+                continue;
+            }
+
+            if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != VK_QUEUE_COMPUTE_BIT) {
+                indices.transferFamily = i;
+                break;
+            }
+            if (!indices.transferFamily.has_value())
+                indices.transferFamily = i;
+        }
+
         return indices;
     }
 
@@ -1657,110 +1875,34 @@ namespace vulkan_tutorial {
                 indices.graphicsFamily = thisIndices.graphicsFamily;
             if (!indices.presentFamily.has_value())
                 indices.presentFamily = thisIndices.presentFamily;
+            if (!indices.transferFamily.has_value())
+                indices.transferFamily = thisIndices.transferFamily;
         }
         return indices;
     }
 
-    void hello_triangle_app::generateMipmaps(
-        VkImage image,
-        VkFormat imageFormat,
-        int32_t texWidth,
-        int32_t texHeight,
-        uint32_t mipLevels
-    ) {
-        VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(_physicalDevices[0], imageFormat, &formatProperties);
-
-        VkFormatFeatureFlagBits requiredFlags = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
-        if ((formatProperties.optimalTilingFeatures & requiredFlags) != requiredFlags)
-            throw std::runtime_error("texture image format does not suppoer linear blitting");
-
-        std::cout << "generating " << mipLevels << " mips." << std::endl;
-
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkImageMemoryBarrier barrier = {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = image;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseArrayLayer = 0u;
-        barrier.subresourceRange.layerCount = 1u;
-        barrier.subresourceRange.levelCount = 1u;
-
-        int32_t mipWidth = texWidth;
-        int32_t mipHeight = texHeight;
-
-        for (uint32_t i = 1u; i < mipLevels; ++i) {
-            barrier.subresourceRange.baseMipLevel = i - 1u;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(
-                commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                0u, nullptr,
-                0u, nullptr,
-                1u, &barrier
-            );
-
-            VkImageBlit blit = {};
-            blit.srcOffsets[0] = { 0, 0, 0 };
-            blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1u;
-            blit.srcSubresource.baseArrayLayer = 0u;
-            blit.srcSubresource.layerCount = 1u;
-            blit.dstOffsets[0] = { 0, 0, 0 };
-            blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1 };
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0u;
-            blit.dstSubresource.layerCount = 1u;
-
-            vkCmdBlitImage(
-                commandBuffer,
-                image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1u, &blit,
-                VK_FILTER_LINEAR
-            );
-
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    uint32_t hello_triangle_app::getTextureDemandLevel() const {
+        // The model spans about this many pixels across the screen, which is as many texels as the sampler can
+        // make use of if its texture is mapped over it once.
+        float distance = glm::length(getCameraPosition());
+        float pixels = _swapchainExtent.height * _meshRadius / (distance * std::tan(FIELD_OF_VIEW / 2.0f));
+        float extent = static_cast<float>(std::max(_textureFile->getWidth(), _textureFile->getHeight()));
 
-            vkCmdPipelineBarrier(
-                commandBuffer,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0u, nullptr,
-                0u, nullptr,
-                1u, &barrier
-            );
-
-            if (mipWidth > 1) mipWidth /= 2;
-            if (mipHeight > 1) mipHeight /= 2;
-        }
-
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1u;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        float level = std::floor(std::log2(extent / std::max(pixels, 1.0f))) - TEXTURE_LEVEL_BIAS;
+        float coarsestLevel = static_cast<float>(_textureFile->getLevels().size() - 1u);
+        return static_cast<uint32_t>(std::clamp(level, 0.0f, coarsestLevel));
+    }
 
-        vkCmdPipelineBarrier(
-            commandBuffer,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-            0u, nullptr,
-            0u, nullptr,
-            1u, &barrier
+    glm::mat4 hello_triangle_app::getViewMatrix() const {
+        return glm::lookAt(
+            getCameraPosition(),
+            glm::vec3(0.0f, 0.0f, 0.0f),
+            glm::vec3(0.0f, 0.0f, 1.0f)
         );
+    }
 
-        endSingleTimeCommands(commandBuffer);
+    glm::vec3 hello_triangle_app::getCameraPosition() const {
+        return CAMERA_POSITION * std::max(_sceneRadius / _meshRadius, 1.0f);
     }
 
     VkSampleCountFlagBits hello_triangle_app::getMaxUsableSampleCount() const {
@@ -1796,12 +1938,29 @@ namespace vulkan_tutorial {
         return *std::min_element(allSampleCounts.begin(), allSampleCounts.end());
     }
 
-    std::vector<const char*> hello_triangle_app::getRequiredExtensions() const {
-        uint32_t glfwExtensionCount = 0u;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    glm::mat4 hello_triangle_app::getProjectionMatrix() const {
+        glm::mat4 projection = glm::perspective(
+            FIELD_OF_VIEW,
+            _swapchainExtent.width / static_cast<float>(_swapchainExtent.height),
+            0.1f,
+            10.0f * glm::length(getCameraPosition()) / glm::length(CAMERA_POSITION)
+        );
+        projection[1][1] *= -1;
+        return projection;
+    }
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    std::vector<const char*> hello_triangle_app::getRequiredExtensions() const {
+        std::vector<const char*> extensions;
+        if (!_options.headless) {
+            uint32_t glfwExtensionCount = 0u;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+            for (const auto& extension : _surfaceInstanceExtensions) {
+                extensions.push_back(extension);
+            }
+        }
         for (const auto& extension : _instanceExtensions) {
             extensions.push_back(extension);
         }
@@ -1842,31 +2001,89 @@ namespace vulkan_tutorial {
     }
 
     void hello_triangle_app::initVulkan() {
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapchain();
-        createImageViews();
-        createRenderPass();
-        createDescriptorSetLayout();
-        createGraphicsPipeline();
-        createCommandPool();
-        createColorResources();
-        createDepthResources();
-        createFramebuffers();
-        createTextureImage();
-        createTextureImageView();
-        createTextureSampler();
-        loadModel();
-        createVertexBuffer();
-        createIndexBuffer();
-        createUniformBuffers();
-        createDescriptorPool();
-        createDescriptorSets();
-        createCommandBuffers();
-        createSyncObjects();
+        auto step = [this](const char* name, const std::function<void()>& function) {
+            timeStartupStep(name, false, function);
+        };
+
+        // Neither needs the device, so both are read on the job system while it's being created.
+        std::future<void> sceneLoaded = _jobs.runAsync([this]() {
+            timeStartupStep("load scene", true, [this]() { loadScene(); });
+        });
+        std::future<void> shadersLoaded = _jobs.runAsync([this]() {
+            timeStartupStep("read shaders", true, [this]() { loadShaders(); });
+        });
+
+        try {
+            step("create instance", [this]() {
+                createInstance();
+                setupDebugMessenger();
+                if (!_options.headless)
+                    createSurface();
+            });
+            step("create device", [this]() {
+                pickPhysicalDevice();
+                createLogicalDevice();
+            });
+            // decoded on the loader threads while everything else is set up, a placeholder is shown until it arrives
+            _textureLoader.load(0u, TEXTURE_PATH, BAKED_TEXTURE_PATH, INITIAL_TEXTURE_EXTENT);
+            step("create swapchain", [this]() {
+                if (_options.headless)
+                    createOffscreenTargets();
+                else
+                    createSwapchain();
+                createImageViews();
+            });
+            step("create render pass", [this]() {
+                createRenderPass();
+                createDescriptorSetLayout();
+            });
+            step("wait for shaders", [&shadersLoaded]() { shadersLoaded.get(); });
+            step("create graphics pipeline", [this]() { createGraphicsPipeline(); });
+            step("create render targets", [this]() {
+                createCommandPool();
+                createColorResources();
+                createDepthResources();
+                createFramebuffers();
+            });
+            step("create placeholder texture", [this]() {
+                createPlaceholderTexture();
+                createTextureSampler();
+            });
+            step("wait for scene", [&sceneLoaded]() { sceneLoaded.get(); });
+            step("upload scene", [this]() {
+                createGeometryArena();
+                for (const auto& mesh : _meshes) {
+                    _meshGeometries.push_back(uploadMesh(*mesh));
+                }
+                uploadInstances();
+            });
+        }
+        catch (...) {
+            // the background steps write into the app, which must outlive them
+            if (sceneLoaded.valid())
+                sceneLoaded.wait();
+            if (shadersLoaded.valid())
+                shadersLoaded.wait();
+            throw;
+        }
+
+        uint64_t uploadTicket = flushUploads();
+        step("create frame resources", [this]() {
+            createUniformBuffers();
+            createDescriptorPool();
+            createDescriptorSets();
+            createCommandBuffers();
+            createSyncObjects();
+            if (_options.gpuCulling)
+                createCuller();
+        });
+        step("wait for uploads", [this, uploadTicket]() {
+            _uploadContext.wait(uploadTicket);
+            _profiler.calibrate(_uploadContext);
+        });
+
+        _allocator.printStats(std::cout);
+        _geometryArena.printStats(std::cout);
     }
 
     void hello_triangle_app::initWindow() {
@@ -1886,53 +2103,171 @@ namespace vulkan_tutorial {
         return false;
     }
 
-    void hello_triangle_app::loadModel() {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warn, err;
+    std::unique_ptr<mesh_file> hello_triangle_app::loadModel(const scene_mesh& source) {
+        auto mesh = std::make_unique<mesh_file>();
 
-        bool result = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH.c_str());
-        if (!result)
-            throw std::runtime_error(warn + err);
-        std::cout << "read " << MODEL_PATH << std::endl;
-
-        std::unordered_map<vertex, uint32_t> uniqueVertices = {};
+        auto startTime = std::chrono::high_resolution_clock::now();
+        if (mesh->open(source.cachePath, source.sourcePath)) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+            std::cout << "mapped " << source.cachePath << ": "
+                << mesh->getVertexCount() << " vertices, " << mesh->getIndexCount() << " indices in "
+                << elapsed.count() << " ms" << std::endl;
+            return mesh;
+        }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                vertex vertex = {};
+        std::vector<vertex> vertices;
+        std::vector<uint32_t> indices;
+
+        obj_loader loader(_jobs);
+        loader.load(source.sourcePath, vertices, indices);
+
+        const auto& stats = loader.getStats();
+        double seconds = stats.parseSeconds + stats.dedupSeconds;
+        std::cout << "read " << source.sourcePath << ": "
+            << stats.vertexCount << " vertices, " << stats.indexCount << " indices in "
+            << seconds * 1000.0 << " ms (parse " << stats.parseSeconds * 1000.0
+            << " ms, dedup " << stats.dedupSeconds * 1000.0 << " ms, "
+            << stats.fileBytes / (1024.0 * 1024.0) / seconds << " MiB/s, "
+            << stats.vertexCount / seconds << " vertices/s)" << std::endl;
+
+        mesh_optimizer optimizer;
+        optimizer.optimize(vertices, indices);
+        printMeshOptimizeStats(optimizer.getStats());
+
+        // a read-only models directory only costs us the cache, not the model
+        try {
+            mesh_file::write(source.cachePath, source.sourcePath, vertices, indices);
+            std::cout << "wrote " << source.cachePath << std::endl;
+        }
+        catch (const std::runtime_error& error) {
+            std::cout << "not caching mesh: " << error.what() << std::endl;
+        }
 
-                vertex.pos = {
-                    attrib.vertices[3 * index.vertex_index + 0],
-                    attrib.vertices[3 * index.vertex_index + 1],
-                    attrib.vertices[3 * index.vertex_index + 2]
-                };
+        mesh->assign(std::move(vertices), std::move(indices));
+        return mesh;
+    }
 
-                vertex.texCoord = {
-                    attrib.texcoords[2 * index.texcoord_index + 0],
-                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-                };
+    void hello_triangle_app::loadScene() {
+        std::vector<std::string> modelPaths = _options.modelPaths;
+        if (modelPaths.empty())
+            modelPaths.push_back(MODEL_PATH);
 
-                vertex.color = { 1.0f, 1.0f, 1.0f };
+        for (const auto& path : modelPaths) {
+            uint32_t mesh = _scene.addMesh(path);
+            _meshes.push_back(loadModel(_scene.getMeshes()[mesh]));
+            _meshRadii.push_back(getBoundingRadius(*_meshes.back()));
+        }
+        _meshRadius = *std::max_element(_meshRadii.begin(), _meshRadii.end());
 
-                if (uniqueVertices.count(vertex) == 0) {
-                    uniqueVertices[vertex] = static_cast<uint32_t>(_vertices.size());
-                    _vertices.push_back(vertex);
-                }
+        // neighbours are half a model apart
+        _scene.addGrid(std::max(_options.instanceCount, 1u), _meshRadius * 3.0f);
+        _sceneRadius = _scene.getRadius(_meshRadii);
+    }
 
-                _indices.push_back(uniqueVertices[vertex]);
-            }
+    void hello_triangle_app::loadShaders() {
+        _fragmentShaderCode = readFile("psmain.spv");
+        std::cout << "read psmain.spv (" << _fragmentShaderCode.size() << " bytes)" << std::endl;
+        _vertexShaderCode = readFile("vsmain.spv");
+        std::cout << "read vsmain.spv (" << _vertexShaderCode.size() << " bytes)" << std::endl;
+        if (_options.gpuCulling) {
+            _cullShaderCode = readFile("cull.spv");
+            std::cout << "read cull.spv (" << _cullShaderCode.size() << " bytes)" << std::endl;
         }
     }
 
     void hello_triangle_app::mainLoop() {
-        while (glfwWindowShouldClose(_window.get()) == GLFW_FALSE) {
-            glfwPollEvents();
+        if (_options.benchmarkFrames > 0u) {
+            std::cout << "benchmarking " << _options.benchmarkFrames << " frames after "
+                << _options.warmupFrames << " warm-up frames ("
+                << (_options.serializeFrames ? "serialized" : "up to " + std::to_string(MAX_FRAMES_IN_FLIGHT) + " in flight")
+                << ")" << std::endl;
+        }
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        auto frameStartTime = startTime;
+        uint32_t frameCount = 0u;
+        uint32_t totalFrames = _options.warmupFrames + _options.benchmarkFrames;
+        std::vector<double> frameTimes;
+        frameTimes.reserve(_options.benchmarkFrames);
+
+        while (_options.headless
+            ? frameCount < totalFrames
+            : glfwWindowShouldClose(_window.get()) == GLFW_FALSE
+        ) {
+            if (!_options.headless)
+                glfwPollEvents();
             drawFrame();
+
+            auto frameEndTime = std::chrono::high_resolution_clock::now();
+            if (_options.benchmarkFrames > 0u && frameCount >= _options.warmupFrames)
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEndTime - frameStartTime).count());
+            frameStartTime = frameEndTime;
+
+            if (++frameCount == _options.warmupFrames) {
+                // measure from here on
+                startTime = frameEndTime;
+                _commandRecordingTime = std::chrono::duration<double, std::milli>(0.0);
+                _recordedCommandBuffers = 0u;
+                _profiler.reset();
+            }
+            if (frameCount == totalFrames && !_options.headless)
+                glfwSetWindowShouldClose(_window.get(), GLFW_TRUE);
         }
 
         vkDeviceWaitIdle(_device);
+
+        if (_options.benchmarkFrames > 0u) {
+            auto endTime = std::chrono::high_resolution_clock::now();
+            std::chrono::duration<double, std::milli> elapsed = endTime - startTime;
+            double seconds = elapsed.count() / 1000.0;
+            uint32_t measuredFrames = static_cast<uint32_t>(frameTimes.size());
+
+            std::cout << "rendered " << measuredFrames << " frames in " << seconds << " s: "
+                << measuredFrames / seconds << " fps, "
+                << seconds * 1000.0 / std::max(measuredFrames, 1u) << " ms/frame" << std::endl;
+            std::cout << "command recording: "
+                << _commandRecordingTime.count() / std::max(_recordedCommandBuffers, 1u) << " ms/frame" << std::endl;
+
+            benchmark_report report = {};
+            report.frameTimes = profile_stats::fromSamples("frame", std::move(frameTimes));
+            printFrameTimes(report.frameTimes);
+
+            if (!_options.reportPath.empty()) {
+                VkPhysicalDeviceProperties deviceProperties;
+                vkGetPhysicalDeviceProperties(_physicalDevices[0], &deviceProperties);
+
+                report.deviceName = deviceProperties.deviceName;
+                report.headless = _options.headless;
+                report.serializeFrames = _options.serializeFrames;
+                report.gpuCulling = _options.gpuCulling;
+                report.warmupFrames = _options.warmupFrames;
+                report.measuredFrames = measuredFrames;
+                report.instanceCount = static_cast<uint32_t>(_scene.getInstances().size());
+                report.drawCount = static_cast<uint32_t>(_drawCommands.size());
+                report.timestep = SIMULATION_TIMESTEP;
+                report.startupTime = _startupTime.count();
+                report.startupSteps = _startupSteps;
+                report.totalTime = elapsed.count();
+                report.stages = _profiler.getStats();
+                report.write(_options.reportPath);
+                std::cout << "wrote benchmark report to " << _options.reportPath << std::endl;
+            }
+        }
+
+        if (!_options.readbackPath.empty() && frameCount > 0u) {
+            // the last frame went to the image before the current one
+            uint32_t imageIndex = (_currentFrame + MAX_FRAMES_IN_FLIGHT - 1u) % MAX_FRAMES_IN_FLIGHT;
+            writeReadback(_options.readbackPath, imageIndex);
+            std::cout << "wrote the last frame to " << _options.readbackPath << std::endl;
+        }
+
+        _textureResidency.printStats(std::cout);
+        _profiler.printStats(std::cout);
+
+        if (!_options.tracePath.empty()) {
+            _profiler.writeChromeTrace(_options.tracePath);
+            std::cout << "wrote trace to " << _options.tracePath << std::endl;
+        }
     }
 
     void hello_triangle_app::pickPhysicalDevice() {
@@ -1981,6 +2316,36 @@ namespace vulkan_tutorial {
         }
     }
 
+    void hello_triangle_app::pollTextures() {
+        destroyRetiredTextures(false);
+
+        // the uploads recorded here are submitted by streamTextures()
+        loaded_texture texture;
+        while (_textureLoader.poll(texture)) {
+            if (!texture.error.empty()) {
+                if (_textureFile == nullptr) {
+                    std::cout << "failed to load " << texture.path << ", keeping the placeholder: " << texture.error
+                        << std::endl;
+                }
+                else {
+                    std::cout << "failed to stream texture levels, keeping the resident ones: " << texture.error
+                        << std::endl;
+                    _textureResidency.setResident(_textureResidencyIndex, _textureBaseLevel);
+                    _textureFile.reset();
+                }
+                continue;
+            }
+
+            if (_textureFile == nullptr) {
+                std::cout << texture.description << std::endl;
+                _textureFile = texture.file;
+                _textureResidencyIndex = _textureResidency.add(_textureFile->getLevels(), texture.baseLevel);
+            }
+
+            rebuildTextureImage(texture.baseLevel, &texture);
+        }
+    }
+
     void hello_triangle_app::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) const {
         createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT;
@@ -2025,11 +2390,13 @@ namespace vulkan_tutorial {
             return 0;
         }
 
-        swap_chain_support_details swapchainSupport = querySwapchainSupport(physicalDevice);
-        if (swapchainSupport.formats.empty()
-            || swapchainSupport.presentModes.empty())
-        {
-            return 0;
+        if (!_options.headless) {
+            swap_chain_support_details swapchainSupport = querySwapchainSupport(physicalDevice);
+            if (swapchainSupport.formats.empty()
+                || swapchainSupport.presentModes.empty())
+            {
+                return 0;
+            }
         }
 
         VkPhysicalDeviceFeatures deviceFeatures;
@@ -2056,6 +2423,324 @@ namespace vulkan_tutorial {
         return score;
     }
 
+    void hello_triangle_app::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = nullptr;
+
+        VkResult beginResult = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+        if (beginResult != VK_SUCCESS)
+            throw std::runtime_error("failed to begin recording command buffer");
+
+        std::array<VkClearValue, 2> clearValues = {};
+        clearValues[0].color = {0.0f, 0.0f, 0.0f, 1.0f};
+        clearValues[1].depthStencil = {1.0f, 0u};
+
+        VkRenderPassBeginInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = _renderPass;
+        renderPassInfo.framebuffer = _swapchainFramebuffers[imageIndex];
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = _swapchainExtent;
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+
+        // Small draw lists aren't worth waking the workers for and are recorded inline.
+        uint32_t drawCount = static_cast<uint32_t>(_drawCommands.size());
+        uint32_t jobCount = std::min(
+            _jobs.getThreadCount(),
+            (drawCount + MIN_DRAWS_PER_RECORDING_JOB - 1u) / MIN_DRAWS_PER_RECORDING_JOB);
+
+        _profiler.beginGpuFrame(commandBuffer, _currentFrame);
+
+        if (_options.gpuCulling) {
+            // a handful of calls per mesh, so there is nothing to record in parallel
+            _culler.recordCulling(commandBuffer, _currentFrame, getProjectionMatrix() * getViewMatrix());
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordIndirectDraws(commandBuffer);
+        }
+        else if (jobCount <= 1u) {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            recordDraws(commandBuffer, 0u, drawCount);
+        }
+        else {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+            VkCommandBufferInheritanceInfo inheritanceInfo = {};
+            inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+            inheritanceInfo.renderPass = _renderPass;
+            inheritanceInfo.subpass = 0u;
+            inheritanceInfo.framebuffer = _swapchainFramebuffers[imageIndex];
+
+            // Every job owns a pool for this frame, so pools are never touched by two threads at once.
+            size_t firstSecondary = static_cast<size_t>(_currentFrame) * _jobs.getThreadCount();
+            _jobs.parallelFor(jobCount, [&](uint32_t job) {
+                VkCommandPool commandPool = _secondaryCommandPools[firstSecondary + job];
+                VkCommandBuffer secondary = _secondaryCommandBuffers[firstSecondary + job];
+                vkResetCommandPool(_device, commandPool, 0u);
+
+                VkCommandBufferBeginInfo secondaryBeginInfo = {};
+                secondaryBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                secondaryBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                    | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                secondaryBeginInfo.pInheritanceInfo = &inheritanceInfo;
+
+                VkResult result = vkBeginCommandBuffer(secondary, &secondaryBeginInfo);
+                if (result != VK_SUCCESS)
+                    throw std::runtime_error("failed to begin recording secondary command buffer");
+
+                uint32_t begin = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * job / jobCount);
+                uint32_t end = static_cast<uint32_t>(static_cast<uint64_t>(drawCount) * (job + 1u) / jobCount);
+                recordDraws(secondary, begin, end);
+
+                result = vkEndCommandBuffer(secondary);
+                if (result != VK_SUCCESS)
+                    throw std::runtime_error("failed to record secondary command buffer");
+            });
+
+            vkCmdExecuteCommands(commandBuffer, jobCount, &_secondaryCommandBuffers[firstSecondary]);
+        }
+
+        vkCmdEndRenderPass(commandBuffer);
+        _profiler.endGpuFrame(commandBuffer, _currentFrame);
+
+        if (!_readbackBuffers.empty()) {
+            VkBufferImageCopy region = {};
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0u;
+            region.imageSubresource.baseArrayLayer = 0u;
+            region.imageSubresource.layerCount = 1u;
+            region.imageExtent = {_swapchainExtent.width, _swapchainExtent.height, 1u};
+            vkCmdCopyImageToBuffer(
+                commandBuffer,
+                _swapchainImages[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                _readbackBuffers[imageIndex],
+                1u, &region);
+
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = _readbackBuffers[imageIndex];
+            barrier.offset = 0u;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                0u, nullptr,
+                1u, &barrier,
+                0u, nullptr
+            );
+        }
+
+        VkResult endResult = vkEndCommandBuffer(commandBuffer);
+        if (endResult != VK_SUCCESS)
+            throw std::runtime_error("failed to record command buffer");
+    }
+
+    void hello_triangle_app::recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw) const {
+        recordDrawState(commandBuffer);
+
+        VkBuffer instanceBuffer = _geometryArena.getBuffer();
+        vkCmdBindVertexBuffers(commandBuffer, 1u, 1u, &instanceBuffer, &_instanceRange.offset);
+        VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+        for (uint32_t i = firstDraw; i < endDraw; ++i) {
+            const auto& draw = _drawCommands[i];
+            if (draw.indexType != boundIndexType) {
+                vkCmdBindIndexBuffer(commandBuffer, _geometryArena.getBuffer(), 0u, draw.indexType);
+                boundIndexType = draw.indexType;
+            }
+            vkCmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+                0u, 1u, &_descriptorSets[_currentFrame],
+                1u, &draw.uniformOffset);
+            vkCmdDrawIndexed(
+                commandBuffer,
+                draw.indexCount,
+                draw.instanceCount,
+                draw.firstIndex,
+                draw.vertexOffset,
+                draw.firstInstance);
+        }
+    }
+
+    void hello_triangle_app::recordDrawState(VkCommandBuffer commandBuffer) const {
+        // state doesn't carry over into secondary command buffers, so every range binds everything it needs
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+
+        VkViewport viewport = {};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = (float) _swapchainExtent.width;
+        viewport.height = (float) _swapchainExtent.height;
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0;
+        vkCmdSetViewport(commandBuffer, 0u, 1u, &viewport);
+
+        VkRect2D scissor = {};
+        scissor.offset = { 0, 0 };
+        scissor.extent = _swapchainExtent;
+        vkCmdSetScissor(commandBuffer, 0u, 1u, &scissor);
+
+        // every mesh lives in the geometry arena, only a change of index type needs another index buffer bind
+        VkBuffer vertexBuffer = _geometryArena.getBuffer();
+        VkDeviceSize offset = 0u;
+        vkCmdBindVertexBuffers(commandBuffer, 0u, 1u, &vertexBuffer, &offset);
+    }
+
+    void hello_triangle_app::recordIndirectDraws(VkCommandBuffer commandBuffer) const {
+        recordDrawState(commandBuffer);
+
+        VkBuffer indirectBuffer = _culler.getIndirectBuffer(_currentFrame);
+        VkBuffer instanceBuffer = _culler.getVisibleInstanceBuffer(_currentFrame);
+        const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+
+        // the culler's draws are in the same order as _drawCommands, which carry the index type and uniforms
+        const auto& batches = _culler.getBatches();
+        for (uint32_t i = 0u; i < batches.size(); ++i) {
+            const auto& batch = batches[i];
+            const auto& draw = _drawCommands[batch.firstDraw];
+            if (draw.indexType != boundIndexType) {
+                vkCmdBindIndexBuffer(commandBuffer, _geometryArena.getBuffer(), 0u, draw.indexType);
+                boundIndexType = draw.indexType;
+            }
+            // binding each batch's visible instances keeps firstInstance at zero, which indirect draws need
+            // without the drawIndirectFirstInstance feature
+            VkDeviceSize instanceOffset = sizeof(instance_data) * batch.firstInstance;
+            vkCmdBindVertexBuffers(commandBuffer, 1u, 1u, &instanceBuffer, &instanceOffset);
+            vkCmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _pipelineLayout,
+                0u, 1u, &_descriptorSets[_currentFrame],
+                1u, &draw.uniformOffset);
+
+            VkDeviceSize drawOffset = _culler.getDrawOffset(batch.firstDraw);
+            if (_drawIndirectCountSupported) {
+                _vkCmdDrawIndexedIndirectCountKHR(
+                    commandBuffer,
+                    indirectBuffer,
+                    drawOffset,
+                    indirectBuffer,
+                    _culler.getCountOffset(i),
+                    batch.drawCount,
+                    stride);
+            }
+            else if (_multiDrawIndirectSupported) {
+                vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, drawOffset, batch.drawCount, stride);
+            }
+            else {
+                for (uint32_t j = 0u; j < batch.drawCount; ++j) {
+                    vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, drawOffset + stride * j, 1u, stride);
+                }
+            }
+        }
+    }
+
+    void hello_triangle_app::rebuildTextureImage(uint32_t baseLevel, const loaded_texture* stagedLevels) {
+        // Images can't gain or lose mip levels, so every residency change builds a new one out of the levels the
+        // old image already holds plus the staged ones. It all happens on the graphics queue, which owns the old
+        // image; frames still sampling it come earlier in submission order than the copy out of it.
+        const auto& levels = _textureFile->getLevels();
+        uint32_t levelCount = static_cast<uint32_t>(levels.size());
+        uint32_t mipLevels = levelCount - baseLevel;
+        VkFormat format = _textureFile->getFormat();
+
+        VkImage image;
+        device_allocation imageAllocation;
+        createImage(
+            levels[baseLevel].width, levels[baseLevel].height, mipLevels,
+            VK_SAMPLE_COUNT_1_BIT,
+            format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            image, imageAllocation
+        );
+        transitionImageLayout(
+            _uploadContext,
+            image,
+            format,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            mipLevels
+        );
+
+        // staged levels are always finer than the resident ones, everything coarser is kept
+        uint32_t firstKeptLevel = std::max(baseLevel, _textureBaseLevel);
+        if (stagedLevels != nullptr) {
+            copyBufferToImage(
+                _uploadContext,
+                stagedLevels->stagingBuffer,
+                image,
+                stagedLevels->levels,
+                stagedLevels->baseLevel - baseLevel);
+            _uploadContext.releaseAfterUpload(stagedLevels->stagingBuffer, stagedLevels->stagingAllocation);
+
+            uint32_t endStagedLevel = stagedLevels->baseLevel + static_cast<uint32_t>(stagedLevels->levels.size());
+            firstKeptLevel = std::max(firstKeptLevel, endStagedLevel);
+        }
+
+        if (_textureImage != VK_NULL_HANDLE) {
+            std::vector<VkImageCopy> regions;
+            for (uint32_t level = firstKeptLevel; level < levelCount; ++level) {
+                VkImageCopy region = {};
+                region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.srcSubresource.mipLevel = level - _textureBaseLevel;
+                region.srcSubresource.baseArrayLayer = 0u;
+                region.srcSubresource.layerCount = 1u;
+                region.dstSubresource = region.srcSubresource;
+                region.dstSubresource.mipLevel = level - baseLevel;
+                region.extent = {levels[level].width, levels[level].height, 1u};
+                regions.push_back(region);
+            }
+
+            transitionImageLayout(
+                _uploadContext,
+                _textureImage,
+                format,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                levelCount - _textureBaseLevel
+            );
+            vkCmdCopyImage(
+                _uploadContext.getCommandBuffer(),
+                _textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                static_cast<uint32_t>(regions.size()), regions.data());
+
+            _retiredTextures.push_back(retired_texture {
+                _textureImage,
+                _textureImageAllocation,
+                _textureImageView,
+                _frameNumber,
+                0u
+            });
+        }
+
+        transitionImageLayout(
+            _uploadContext,
+            image,
+            format,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            mipLevels
+        );
+
+        _textureImage = image;
+        _textureImageAllocation = imageAllocation;
+        _textureImageView = createImageView(image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+        _textureBaseLevel = baseLevel;
+        _textureResidency.setResident(_textureResidencyIndex, baseLevel);
+
+        std::cout << "texture residency: " << levels[baseLevel].width << 'x' << levels[baseLevel].height
+            << " and " << mipLevels - 1u << " smaller mips, "
+            << _textureResidency.getResidentBytes(_textureResidencyIndex) / 1024u << " KiB" << std::endl;
+    }
+
     void hello_triangle_app::recreateSwapchain() {
         int width = 0, height = 0;
         while (width == 0 || height == 0) {
@@ -2067,17 +2752,22 @@ namespace vulkan_tutorial {
 
         cleanupSwapchain();
 
+        // Only the extent-dependent resources are rebuilt. The render pass, and with it the pipeline, only depends
+        // on the surface format, which practically never changes.
+        VkFormat previousImageFormat = _swapchainImageFormat;
         createSwapchain();
         createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
+        if (_swapchainImageFormat != previousImageFormat) {
+            vkDestroyPipeline(_device, _graphicsPipeline, nullptr);
+            vkDestroyPipelineLayout(_device, _pipelineLayout, nullptr);
+            vkDestroyRenderPass(_device, _renderPass, nullptr);
+            createRenderPass();
+            createGraphicsPipeline();
+        }
         createColorResources();
         createDepthResources();
         createFramebuffers();
-        createUniformBuffers();
-        createDescriptorPool();
-        createDescriptorSets();
-        createCommandBuffers();
+        _uploadContext.wait(flushUploads());
     }
 
     void hello_triangle_app::setupDebugMessenger() {
@@ -2092,14 +2782,109 @@ namespace vulkan_tutorial {
 #endif
     }
 
+    void hello_triangle_app::transferBufferOwnership(
+        VkBuffer buffer,
+        VkDeviceSize offset,
+        VkDeviceSize size,
+        VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags dstStageMask
+    ) {
+        VkBufferMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.buffer = buffer;
+        barrier.offset = offset;
+        barrier.size = size;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+        if (_queueFamilyIndices.transferFamily.has_value()) {
+            barrier.srcQueueFamilyIndex = _queueFamilyIndices.transferFamily.value();
+            barrier.dstQueueFamilyIndex = _queueFamilyIndices.graphicsFamily.value();
+        }
+
+        // release on the transfer queue
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0u;
+        vkCmdPipelineBarrier(
+            _transferContext.getCommandBuffer(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0u, nullptr,
+            1u, &barrier,
+            0u, nullptr
+        );
+
+        // acquire on the graphics queue
+        barrier.srcAccessMask = 0u;
+        barrier.dstAccessMask = dstAccessMask;
+        vkCmdPipelineBarrier(
+            _uploadContext.getCommandBuffer(),
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0,
+            0u, nullptr,
+            1u, &barrier,
+            0u, nullptr
+        );
+    }
+
+    void hello_triangle_app::transferImageOwnership(
+        VkImage image,
+        uint32_t mipLevels,
+        VkImageLayout oldLayout,
+        VkImageLayout newLayout,
+        VkAccessFlags dstAccessMask,
+        VkPipelineStageFlags dstStageMask
+    ) {
+        VkImageMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0u;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0u;
+        barrier.subresourceRange.layerCount = 1u;
+
+        if (_queueFamilyIndices.transferFamily.has_value()) {
+            barrier.srcQueueFamilyIndex = _queueFamilyIndices.transferFamily.value();
+            barrier.dstQueueFamilyIndex = _queueFamilyIndices.graphicsFamily.value();
+        }
+
+        // release on the transfer queue
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0u;
+        vkCmdPipelineBarrier(
+            _transferContext.getCommandBuffer(),
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0u, nullptr,
+            0u, nullptr,
+            1u, &barrier
+        );
+
+        // acquire on the graphics queue; on a shared queue the barrier above has already changed the layout
+        if (!_queueFamilyIndices.transferFamily.has_value())
+            barrier.oldLayout = newLayout;
+        barrier.srcAccessMask = 0u;
+        barrier.dstAccessMask = dstAccessMask;
+        vkCmdPipelineBarrier(
+            _uploadContext.getCommandBuffer(),
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0,
+            0u, nullptr,
+            0u, nullptr,
+            1u, &barrier
+        );
+    }
+
     void hello_triangle_app::transitionImageLayout(
+        upload_context& context,
         VkImage image,
         VkFormat format,
         VkImageLayout oldLayout,
         VkImageLayout newLayout,
         uint32_t mipLevels
     ) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+        VkCommandBuffer commandBuffer = context.getCommandBuffer();
 
         VkImageMemoryBarrier barrier = {};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -2146,6 +2931,16 @@ namespace vulkan_tutorial {
             sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
             destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         }
+        else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            && newLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        ) {
+            // only earlier frames' sampling has to finish first, which needs no memory dependency
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            sourceStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
         else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED
             && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
         ) {
@@ -2177,38 +2972,285 @@ namespace vulkan_tutorial {
             0u, nullptr,
             1u, &barrier
         );
+    }
+
+    void hello_triangle_app::streamTextures() {
+        if (_textureFile != nullptr) {
+            _textureResidency.request(_textureResidencyIndex, getTextureDemandLevel(), _frameNumber);
+
+            for (const auto& change : _textureResidency.update(_frameNumber)) {
+                if (change.baseLevel > _textureBaseLevel)
+                    rebuildTextureImage(change.baseLevel, nullptr);
+                else
+                    _textureLoader.loadLevels(change.texture, _textureFile, change.baseLevel, _textureBaseLevel);
+            }
+        }
+
+        // submitted ahead of this frame on the graphics queue, whose barrier orders the copies before any sampling;
+        // the images they copy out of can go once this batch has completed
+        uint64_t uploadTicket = flushUploads();
+        for (auto& retired : _retiredTextures) {
+            if (retired.uploadTicket == 0u)
+                retired.uploadTicket = uploadTicket;
+        }
+    }
+
+    void hello_triangle_app::timeStartupStep(const char* name, bool background, const std::function<void()>& step) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        step();
+        auto endTime = std::chrono::high_resolution_clock::now();
 
-        endSingleTimeCommands(commandBuffer);
+        std::lock_guard<std::mutex> lock(_startupStepsMutex);
+        _startupSteps.push_back(startup_step {
+            name,
+            background,
+            std::chrono::duration<double, std::milli>(startTime - _startTime).count(),
+            std::chrono::duration<double, std::milli>(endTime - startTime).count()
+        });
     }
 
     void hello_triangle_app::toggleFullscreen() {
         _fullscreenToggleRequested = true;
     }
 
-    void hello_triangle_app::updateUniformBuffer(uint32_t currentImage) {
-        static auto startTime = std::chrono::high_resolution_clock::now();
+    void hello_triangle_app::updateTextureDescriptor(uint32_t frameIndex) {
+        VkImageView imageView = _textureImageView != VK_NULL_HANDLE ? _textureImageView : _placeholderImageView;
+        if (_descriptorImageViews[frameIndex] == imageView)
+            return;
 
-        auto currentTime = std::chrono::high_resolution_clock::now();
-        float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+        VkDescriptorImageInfo imageInfo = {};
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        imageInfo.imageView = imageView;
+        imageInfo.sampler = _textureSampler;
+
+        VkWriteDescriptorSet descriptorWrite = {};
+        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet = _descriptorSets[frameIndex];
+        descriptorWrite.dstBinding = 1u;
+        descriptorWrite.dstArrayElement = 0u;
+        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1u;
+        descriptorWrite.pBufferInfo = nullptr;
+        descriptorWrite.pImageInfo = &imageInfo;
+        descriptorWrite.pTexelBufferView = nullptr;
+
+        vkUpdateDescriptorSets(_device, 1u, &descriptorWrite, 0u, nullptr);
+        _descriptorImageViews[frameIndex] = imageView;
+    }
+
+    uint32_t hello_triangle_app::updateUniformBuffer(const mesh_geometry& geometry) {
+        // benchmarks step the scene by a fixed amount per frame so every run renders the same frames
+        float time = _options.benchmarkFrames > 0u
+            ? static_cast<float>(_frameNumber) * SIMULATION_TIMESTEP
+            : std::chrono::duration<float, std::chrono::seconds::period>(
+                std::chrono::high_resolution_clock::now() - _startTime).count();
 
         uniform_buffer_object ubo = {};
         ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(30.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ubo.view = glm::lookAt(
-            glm::vec3(2.0f, 2.0f, 2.0f),
-            glm::vec3(0.0f, 0.0f, 0.0f),
-            glm::vec3(0.0f, 0.0f, 1.0f)
+        ubo.texCoordTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+        if (_options.compactVertices) {
+            const auto& quantization = geometry.quantization;
+            ubo.model = glm::scale(glm::translate(ubo.model, quantization.positionOffset), quantization.positionScale);
+            ubo.texCoordTransform = glm::vec4(quantization.texCoordScale, quantization.texCoordOffset);
+        }
+        ubo.view = getViewMatrix();
+        ubo.proj = getProjectionMatrix();
+
+        return _uniformRing.push(ubo);
+    }
+
+    void hello_triangle_app::uploadInstances() {
+        const auto& instances = _scene.getInstances();
+        VkDeviceSize size = sizeof(instance_data) * instances.size();
+        _instanceRange = _geometryArena.allocate(size, sizeof(instance_data));
+
+        VkBuffer stagingBuffer;
+        device_allocation stagingBufferAllocation;
+        createBuffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer,
+            stagingBufferAllocation
         );
-        ubo.proj = glm::perspective(
-            glm::radians(45.0f),
-            _swapchainExtent.width / static_cast<float>(_swapchainExtent.height),
-            0.1f,
-            10.0f
+
+        auto instanceData = static_cast<instance_data*>(stagingBufferAllocation.mapped);
+        for (size_t i = 0; i < instances.size(); ++i) {
+            instanceData[i].transform = instances[i].transform;
+        }
+
+        VkBuffer arenaBuffer = _geometryArena.getBuffer();
+        copyBuffer(stagingBuffer, 0u, arenaBuffer, _instanceRange.offset, size);
+        _transferContext.releaseAfterUpload(stagingBuffer, stagingBufferAllocation);
+
+        transferBufferOwnership(
+            arenaBuffer,
+            _instanceRange.offset,
+            size,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        _instanceBatches = _scene.getBatches();
+        std::cout << "scene: " << instances.size() << " instances of " << _scene.getMeshes().size()
+            << " meshes in " << _instanceBatches.size() << " instanced batches" << std::endl;
+    }
+
+    mesh_geometry hello_triangle_app::uploadMesh(const mesh_file& mesh) {
+        const uint32_t* indices = mesh.getIndices();
+        size_t indexCount = mesh.getIndexCount();
+        size_t vertexCount = mesh.getVertexCount();
+
+        mesh_geometry geometry = {};
+
+        // 16-bit indices halve the index data whenever every draw spans at most 65536 vertices
+        geometry.indexType = VK_INDEX_TYPE_UINT16;
+        if (vertexCount > static_cast<size_t>(std::numeric_limits<uint16_t>::max()) + 1u) {
+            if (_options.splitMeshes)
+                geometry.subMeshes = mesh_optimizer::splitForShortIndices(indices, indexCount);
+            if (geometry.subMeshes.empty())
+                geometry.indexType = VK_INDEX_TYPE_UINT32;
+        }
+        if (geometry.subMeshes.empty())
+            geometry.subMeshes.push_back(sub_mesh { 0u, static_cast<uint32_t>(indexCount), 0 });
+
+        VkDeviceSize vertexSize = _options.compactVertices ? sizeof(compact_vertex) : sizeof(vertex);
+        VkDeviceSize indexSize = geometry.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        VkDeviceSize vertexBytes = vertexSize * vertexCount;
+        VkDeviceSize indexBytes = indexSize * indexCount;
+
+        geometry.vertexRange = _geometryArena.allocate(vertexBytes, vertexSize);
+        geometry.indexRange = _geometryArena.allocate(indexBytes, indexSize);
+
+        // vertices and indices share one staging buffer, the vertex bytes keep the indices aligned
+        VkBuffer stagingBuffer;
+        device_allocation stagingBufferAllocation;
+        createBuffer(
+            vertexBytes + indexBytes,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer,
+            stagingBufferAllocation
+        );
+        char* staging = static_cast<char*>(stagingBufferAllocation.mapped);
+
+        if (_options.compactVertices) {
+            // the cache keeps full precision, so the bounds are taken and the vertices quantized on every upload
+            const vertex* vertices = mesh.getVertices();
+            geometry.quantization = vertex_quantization::fromBounds(vertices, vertexCount);
+
+            auto compactVertices = reinterpret_cast<compact_vertex*>(staging);
+            for (size_t i = 0; i < vertexCount; ++i) {
+                compactVertices[i] = compact_vertex::quantize(vertices[i], geometry.quantization);
+            }
+            std::cout << "compacted " << vertexCount << " vertices from "
+                << sizeof(vertex) * vertexCount / 1024u << " KiB to " << vertexBytes / 1024u << " KiB" << std::endl;
+        }
+        else {
+            memcpy(staging, mesh.getVertices(), static_cast<size_t>(vertexBytes));
+        }
+
+        if (geometry.indexType == VK_INDEX_TYPE_UINT16) {
+            auto shortIndices = reinterpret_cast<uint16_t*>(staging + vertexBytes);
+            for (const auto& subMesh : geometry.subMeshes) {
+                uint32_t endIndex = subMesh.firstIndex + subMesh.indexCount;
+                for (uint32_t i = subMesh.firstIndex; i < endIndex; ++i) {
+                    shortIndices[i] = static_cast<uint16_t>(indices[i] - static_cast<uint32_t>(subMesh.vertexOffset));
+                }
+            }
+            std::cout << "using 16-bit indices in " << geometry.subMeshes.size() << " draw"
+                << (geometry.subMeshes.size() == 1u ? "" : "s") << ", " << indexBytes / 1024u << " KiB instead of "
+                << sizeof(uint32_t) * indexCount / 1024u << " KiB" << std::endl;
+        }
+        else {
+            memcpy(staging + vertexBytes, indices, static_cast<size_t>(indexBytes));
+        }
+
+        // draws address the arena as a whole
+        for (auto& subMesh : geometry.subMeshes) {
+            subMesh.firstIndex += static_cast<uint32_t>(geometry.indexRange.offset / indexSize);
+            subMesh.vertexOffset += static_cast<int32_t>(geometry.vertexRange.offset / vertexSize);
+        }
+
+        VkBuffer arenaBuffer = _geometryArena.getBuffer();
+        copyBuffer(stagingBuffer, 0u, arenaBuffer, geometry.vertexRange.offset, vertexBytes);
+        copyBuffer(stagingBuffer, vertexBytes, arenaBuffer, geometry.indexRange.offset, indexBytes);
+        _transferContext.releaseAfterUpload(stagingBuffer, stagingBufferAllocation);
+
+        transferBufferOwnership(
+            arenaBuffer,
+            geometry.vertexRange.offset,
+            vertexBytes,
+            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+        transferBufferOwnership(
+            arenaBuffer,
+            geometry.indexRange.offset,
+            indexBytes,
+            VK_ACCESS_INDEX_READ_BIT,
+            VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+
+        return geometry;
+    }
+
+    void hello_triangle_app::uploadTexture(
+        const loaded_texture& texture,
+        VkImage& image,
+        device_allocation& imageAllocation
+    ) {
+        uint32_t mipLevels = static_cast<uint32_t>(texture.levels.size());
+
+        createImage(
+            texture.width, texture.height, mipLevels,
+            VK_SAMPLE_COUNT_1_BIT,
+            texture.format,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            image, imageAllocation
         );
-        ubo.proj[1][1] *= -1;
+        transitionImageLayout(
+            _transferContext,
+            image,
+            texture.format,
+            VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            mipLevels
+        );
+        copyBufferToImage(_transferContext, texture.stagingBuffer, image, texture.levels, 0u);
+        // the staging buffer now belongs to the transfer context
+        _transferContext.releaseAfterUpload(texture.stagingBuffer, texture.stagingAllocation);
+
+        // every mip is already there, so the image goes straight to its final layout while changing queues
+        transferImageOwnership(
+            image,
+            mipLevels,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_ACCESS_SHADER_READ_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+        );
+    }
+
+    void hello_triangle_app::writeReadback(const std::string& path, uint32_t imageIndex) const {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("failed to open " + path + " for writing");
+
+        file << "P6\n" << _swapchainExtent.width << ' ' << _swapchainExtent.height << "\n255\n";
+
+        const auto* pixels = static_cast<const uint8_t*>(_readbackBufferAllocations[imageIndex].mapped);
+        std::vector<char> row(_swapchainExtent.width * 3u);
+        for (uint32_t y = 0u; y < _swapchainExtent.height; ++y) {
+            for (uint32_t x = 0u; x < _swapchainExtent.width; ++x) {
+                const uint8_t* pixel = pixels + (static_cast<size_t>(y) * _swapchainExtent.width + x) * 4u;
+                row[x * 3u + 0u] = static_cast<char>(pixel[0]);
+                row[x * 3u + 1u] = static_cast<char>(pixel[1]);
+                row[x * 3u + 2u] = static_cast<char>(pixel[2]);
+            }
+            file.write(row.data(), static_cast<std::streamsize>(row.size()));
+        }
 
-        void* data;
-        vkMapMemory(_device, _uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-        memcpy(data, &ubo, sizeof(ubo));
-        vkUnmapMemory(_device, _uniformBuffersMemory[currentImage]);
+        if (!file)
+            throw std::runtime_error("failed to write " + path);
     }
 }
@@ -1,11 +1,31 @@
 #pragma once
 
+#include "app_options.h"
+#include "benchmark_report.h"
+#include "device_memory_allocator.h"
+#include "geometry_arena.h"
+#include "gpu_culler.h"
+#include "job_system.h"
+#include "mesh_file.h"
+#include "mesh_optimizer.h"
+#include "pipeline_cache.h"
+#include "profiler.h"
+#include "scene.h"
 #include "scoped_glfw_window.h"
+#include "texture_loader.h"
+#include "texture_residency.h"
+#include "uniform_ring_buffer.h"
+#include "upload_context.h"
+#include "vertex.h"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <array>
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <vector>
 
 #ifndef NDEBUG
@@ -13,9 +33,40 @@
 #endif
 
 namespace vulkan_tutorial {
+    struct draw_command {
+        VkIndexType indexType;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        uint32_t instanceCount;
+        uint32_t firstInstance;
+        uint32_t uniformOffset;
+    };
+
+    // Where a mesh lives in the geometry arena. The sub-mesh draws already address the arena as a whole.
+    struct mesh_geometry {
+        geometry_range vertexRange;
+        geometry_range indexRange;
+        VkIndexType indexType;
+        std::vector<sub_mesh> subMeshes;
+        // only used with compact vertices
+        vertex_quantization quantization;
+    };
+
+    // A texture image replaced by a streaming change, destroyed once neither a frame nor an upload uses it.
+    struct retired_texture {
+        VkImage image;
+        device_allocation allocation;
+        VkImageView view;
+        uint64_t frameNumber;
+        // zero until the upload batch copying out of the image has been submitted
+        uint64_t uploadTicket;
+    };
+
     struct queue_family_indices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily;
 
         bool isComplete() const {
             return graphicsFamily.has_value()
@@ -33,61 +84,75 @@ namespace vulkan_tutorial {
         alignas(16) glm::mat4 model;
         alignas(16) glm::mat4 view;
         alignas(16) glm::mat4 proj;
-    };
-
-    struct vertex {
-        glm::vec3 pos;
-        glm::vec3 color;
-        glm::vec2 texCoord;
-
-        static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
-        static VkVertexInputBindingDescription getBindingDescription();
-
-        bool operator==(const vertex& other) const {
-            return pos == other.pos && texCoord == other.texCoord && color == other.color;
-        }
+        // xy scale, zw offset
+        alignas(16) glm::vec4 texCoordTransform;
     };
 
     class hello_triangle_app {
     public:
-        hello_triangle_app();
+        explicit hello_triangle_app(const app_options& options = {});
         ~hello_triangle_app();
 
         void run();
 
     private:
+        // every mesh's vertices and indices and the instance data are sub-allocated from one buffer of this size
+        static const VkDeviceSize GEOMETRY_ARENA_SIZE = 64u * 1024u * 1024u;
         static const int INITIAL_HEIGHT = 600;
+        static const uint32_t INITIAL_TEXTURE_EXTENT = 128u;
         static const int INITIAL_WIDTH = 800;
         static const int MAX_FRAMES_IN_FLIGHT = 3;
+        static const uint32_t MIN_DRAWS_PER_RECORDING_JOB = 256u;
+        // how many levels finer than the estimated screen-space demand to stream in
+        static const uint32_t TEXTURE_LEVEL_BIAS = 1u;
+        static const VkDeviceSize UNIFORM_RING_FRAME_SIZE = 64u * 1024u;
 
+        const glm::vec3 CAMERA_POSITION = glm::vec3(2.0f, 2.0f, 2.0f);
+        const float FIELD_OF_VIEW = glm::radians(45.0f);
         const std::string MODEL_PATH = "models/chalet.obj";
+        const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+        // seconds the scene advances per benchmark frame
+        const float SIMULATION_TIMESTEP = 1.0f / 60.0f;
+        const std::string BAKED_TEXTURE_PATH = "textures/chalet.tex";
         const std::string TEXTURE_PATH = "textures/chalet.jpg";
 
         bool _fullscreenToggleRequested;
+        const app_options _options;
 
         scoped_glfw_window _window;
 
         VkInstance _instance;
         VkSurfaceKHR _surface;
         VkDevice _device;
+        device_memory_allocator _allocator;
         std::vector<VkPhysicalDevice> _physicalDevices;
         const std::vector<const char*> _deviceExtensions;
         const std::vector<const char*> _instanceExtensions;
+        // only enabled when rendering to a window
+        const std::vector<const char*> _surfaceInstanceExtensions;
         const std::vector<const char*> _validationLayers;
 
         VkQueue _graphicsQueue;
         VkQueue _presentQueue;
+        VkQueue _transferQueue;
+        queue_family_indices _queueFamilyIndices;
 
         VkDebugUtilsMessengerEXT _debugMessenger;
         VkSampleCountFlagBits _msaaSamples;
 
         // TODO first candidate for first pass refactor into own class
-        VkCommandPool _commandPool;
         VkPipeline _graphicsPipeline;
+        pipeline_cache _pipelineCache;
         VkDescriptorPool _descriptorPool;
         VkDescriptorSetLayout _descriptorSetLayout;
+        // one set per frame in flight, so the texture can be swapped without touching a set the GPU may be using
         std::vector<VkDescriptorSet> _descriptorSets;
+        std::vector<VkImageView> _descriptorImageViews;
         VkPipelineLayout _pipelineLayout;
+        // SPIR-V is read once, the pipeline is rebuilt whenever the swapchain format changes
+        std::vector<char> _cullShaderCode;
+        std::vector<char> _fragmentShaderCode;
+        std::vector<char> _vertexShaderCode;
         VkRenderPass _renderPass;
         VkSwapchainKHR _swapchain;
         VkExtent2D _swapchainExtent;
@@ -95,38 +160,82 @@ namespace vulkan_tutorial {
         VkFormat _swapchainImageFormat;
         std::vector<VkImage> _swapchainImages;
         std::vector<VkImageView> _swapchainImageViews;
+        // in headless mode the "swapchain" images are plain images owned by the app, one per frame in flight
+        std::vector<device_allocation> _offscreenImageAllocations;
+        std::vector<VkBuffer> _readbackBuffers;
+        std::vector<device_allocation> _readbackBufferAllocations;
 
+        std::vector<VkCommandPool> _commandPools;
         std::vector<VkCommandBuffer> _commandBuffers;
+        std::vector<VkCommandPool> _secondaryCommandPools;
+        std::vector<VkCommandBuffer> _secondaryCommandBuffers;
+        std::vector<draw_command> _drawCommands;
+        job_system _jobs;
+        profiler _profiler;
+        std::chrono::duration<double, std::milli> _commandRecordingTime;
+        uint32_t _recordedCommandBuffers;
         std::vector<VkSemaphore> _imageAvailableSemaphores;
         std::vector<VkSemaphore> _renderFinishedSemaphores;
         std::vector<VkFence> _inFlightFences;
+        // fence of the frame that last rendered to each swapchain image, VK_NULL_HANDLE if none
+        std::vector<VkFence> _imagesInFlight;
         uint32_t _currentFrame;
+        uint64_t _frameNumber;
+        std::chrono::high_resolution_clock::time_point _startTime;
+        std::chrono::duration<double, std::milli> _startupTime;
+        std::vector<startup_step> _startupSteps;
+        std::mutex _startupStepsMutex;
         bool _framebufferResized;
 
         VkImage _colorImage;
-        VkDeviceMemory _colorImageMemory;
+        device_allocation _colorImageAllocation;
         VkImageView _colorImageView;
 
         VkImage _depthImage;
-        VkDeviceMemory _depthImageMemory;
+        device_allocation _depthImageAllocation;
         VkImageView _depthImageView;
 
-        std::vector<uint32_t> _indices;
-        VkBuffer _indexBuffer;
-        VkDeviceMemory _indexBufferMemory;
+        geometry_arena _geometryArena;
+        // indexed like the scene's meshes
+        std::vector<std::unique_ptr<mesh_file>> _meshes;
+        std::vector<mesh_geometry> _meshGeometries;
+        std::vector<float> _meshRadii;
+        // the largest of the mesh radii
+        float _meshRadius;
+
+        scene _scene;
+        std::vector<instance_batch> _instanceBatches;
+        geometry_range _instanceRange;
+        float _sceneRadius;
+
+        gpu_culler _culler;
+        // without the extension every batch draws all of its sub-meshes, visible or not
+        bool _drawIndirectCountSupported;
+        // without the feature every indirect draw is a call of its own
+        bool _multiDrawIndirectSupported;
+        PFN_vkCmdDrawIndexedIndirectCountKHR _vkCmdDrawIndexedIndirectCountKHR;
 
-        uint32_t _mipLevels;
+        VkImage _placeholderImage;
+        device_allocation _placeholderImageAllocation;
+        VkImageView _placeholderImageView;
+        bool _textureCompressionSupported;
+        texture_loader _textureLoader;
+        texture_residency _textureResidency;
+        std::vector<retired_texture> _retiredTextures;
+        // the streamed texture is made of levels [_textureBaseLevel, level count) of _textureFile
+        std::shared_ptr<const texture_file> _textureFile;
+        uint32_t _textureBaseLevel;
+        uint32_t _textureResidencyIndex;
         VkImage _textureImage;
-        VkDeviceMemory _textureImageMemory;
+        device_allocation _textureImageAllocation;
         VkImageView _textureImageView;
         VkSampler _textureSampler;
 
-        std::vector<vertex> _vertices;
-        VkBuffer _vertexBuffer;
-        VkDeviceMemory _vertexBufferMemory;
 
-        std::vector<VkBuffer> _uniformBuffers;
-        std::vector<VkDeviceMemory> _uniformBuffersMemory;
+        uniform_ring_buffer _uniformRing;
+
+        upload_context _transferContext;
+        upload_context _uploadContext;
 
     private:
         static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -137,7 +246,6 @@ namespace vulkan_tutorial {
         );
         static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
 
-        VkCommandBuffer beginSingleTimeCommands();
         bool checkDeviceExtensionsSupport(VkPhysicalDevice device) const;
         bool checkValidationLayerSupport() const;
         VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
@@ -145,23 +253,35 @@ namespace vulkan_tutorial {
         VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) const;
         void cleanup();
         void cleanupSwapchain();
-        void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-        void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+        void copyBuffer(
+            VkBuffer srcBuffer,
+            VkDeviceSize srcOffset,
+            VkBuffer dstBuffer,
+            VkDeviceSize dstOffset,
+            VkDeviceSize size);
+        void copyBufferToImage(
+            upload_context& context,
+            VkBuffer buffer,
+            VkImage image,
+            const std::vector<texture_level>& levels,
+            uint32_t firstMipLevel);
         void createBuffer(
             VkDeviceSize size,
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory
+            device_allocation& bufferAllocation
         );
         void createColorResources();
         void createCommandBuffers();
         void createCommandPool();
+        void createCuller();
         void createDepthResources();
         void createDescriptorPool();
         void createDescriptorSetLayout();
         void createDescriptorSets();
         void createFramebuffers();
+        void createGeometryArena();
         void createGraphicsPipeline();
         void createImage(
             uint32_t width,
@@ -173,25 +293,24 @@ namespace vulkan_tutorial {
             VkImageUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory);
+            device_allocation& imageAllocation);
         VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
         void createImageViews();
-        void createIndexBuffer();
         void createInstance();
         void createLogicalDevice();
+        void createOffscreenTargets();
         void createRenderPass();
         void createSyncObjects();
         VkShaderModule createShaderModule(const std::vector<char>& code);
         void createSurface();
         void createSwapchain();
-        void createTextureImage();
-        void createTextureImageView();
+        void createPlaceholderTexture();
         void createTextureSampler();
         void createUniformBuffers();
-        void createVertexBuffer();
+        void destroyRetiredTextures(bool force);
         void drawFrame();
-        void endSingleTimeCommands(VkCommandBuffer commandBuffer);
         VkFormat findDepthFormat() const;
+        uint64_t flushUploads();
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
         VkFormat findSupportedFormat(
             const std::vector<VkFormat>& candidates,
@@ -199,9 +318,13 @@ namespace vulkan_tutorial {
             VkFormatFeatureFlags features) const;
         queue_family_indices findQueueFamilies(VkPhysicalDevice physicalDevice) const;
         queue_family_indices findQueueFamilies() const;
-        void generateMipmaps(VkImage image, VkFormat format, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
+        // pulled back from CAMERA_POSITION until the whole scene fits
+        glm::vec3 getCameraPosition() const;
         VkSampleCountFlagBits getMaxUsableSampleCount() const;
+        glm::mat4 getProjectionMatrix() const;
         std::vector<const char*> getRequiredExtensions() const;
+        uint32_t getTextureDemandLevel() const;
+        glm::mat4 getViewMatrix() const;
         static void handleGlfwKeyPress(GLFWwindow* window, int key, int scancode, int action, int mods);
         void handleKeyPress(int32_t key, int32_t scancode, int32_t action, int32_t mods);
         bool hasStencilComponent(VkFormat format) const;
@@ -209,21 +332,50 @@ namespace vulkan_tutorial {
         void initVulkan();
         void initWindow();
         bool isFullscreen() const;
-        void loadModel();
+        std::unique_ptr<mesh_file> loadModel(const scene_mesh& source);
+        void loadScene();
+        void loadShaders();
         void mainLoop();
         void pickPhysicalDevice();
+        void pollTextures();
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) const;
         swap_chain_support_details querySwapchainSupport(VkPhysicalDevice device) const;
         int32_t rateDeviceSuitability(VkPhysicalDevice device) const;
+        void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        void recordDraws(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t endDraw) const;
+        void recordDrawState(VkCommandBuffer commandBuffer) const;
+        void recordIndirectDraws(VkCommandBuffer commandBuffer) const;
+        void rebuildTextureImage(uint32_t baseLevel, const loaded_texture* stagedLevels);
         void recreateSwapchain();
         void setupDebugMessenger();
+        void streamTextures();
+        void timeStartupStep(const char* name, bool background, const std::function<void()>& step);
         void toggleFullscreen();
+        void transferBufferOwnership(
+            VkBuffer buffer,
+            VkDeviceSize offset,
+            VkDeviceSize size,
+            VkAccessFlags dstAccessMask,
+            VkPipelineStageFlags dstStageMask);
+        void transferImageOwnership(
+            VkImage image,
+            uint32_t mipLevels,
+            VkImageLayout oldLayout,
+            VkImageLayout newLayout,
+            VkAccessFlags dstAccessMask,
+            VkPipelineStageFlags dstStageMask);
         void transitionImageLayout(
+            upload_context& context,
             VkImage image,
             VkFormat format,
             VkImageLayout oldLayout,
             VkImageLayout newLayout,
             uint32_t mipLevels);
-        void updateUniformBuffer(uint32_t imageIndex);
+        void updateTextureDescriptor(uint32_t frameIndex);
+        uint32_t updateUniformBuffer(const mesh_geometry& geometry);
+        void uploadInstances();
+        mesh_geometry uploadMesh(const mesh_file& mesh);
+        void uploadTexture(const loaded_texture& texture, VkImage& image, device_allocation& imageAllocation);
+        void writeReadback(const std::string& path, uint32_t imageIndex) const;
    };
 }
@@ -0,0 +1,139 @@
+#include "job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <utility>
+
+namespace {
+    struct parallel_for_state {
+        std::function<void(uint32_t)> job;
+        uint32_t count;
+        std::atomic<uint32_t> next;
+        std::mutex mutex;
+        std::condition_variable doneCondition;
+        uint32_t completed;
+        std::exception_ptr error;
+    };
+
+    // Runs iterations until none are left. Late workers find nothing to do and only touch the shared state, which
+    // they keep alive themselves.
+    void drain(const std::shared_ptr<parallel_for_state>& state) {
+        uint32_t done = 0u;
+        std::exception_ptr error;
+
+        for (uint32_t i = state->next++; i < state->count; i = state->next++) {
+            try {
+                state->job(i);
+            }
+            catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+            ++done;
+        }
+
+        if (done == 0u)
+            return;
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (error && !state->error)
+            state->error = error;
+        state->completed += done;
+        if (state->completed == state->count)
+            state->doneCondition.notify_all();
+    }
+}
+
+namespace vulkan_tutorial {
+    job_system::job_system(uint32_t workerCount)
+      : _queue {},
+        _stopping {false},
+        _workers {}
+    {
+        for (uint32_t i = 0u; i < workerCount; ++i) {
+            _workers.emplace_back(&job_system::workerMain, this);
+        }
+    }
+
+    job_system::~job_system() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wakeCondition.notify_all();
+
+        for (auto& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t job_system::getDefaultWorkerCount() {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        return std::max(hardwareThreads, 2u) - 1u;
+    }
+
+    void job_system::parallelFor(uint32_t count, const std::function<void(uint32_t)>& job) {
+        if (count == 0u)
+            return;
+
+        auto state = std::make_shared<parallel_for_state>();
+        state->job = job;
+        state->count = count;
+        state->next = 0u;
+        state->completed = 0u;
+
+        uint32_t helpers = std::min(static_cast<uint32_t>(_workers.size()), count - 1u);
+        if (helpers > 0u) {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                for (uint32_t i = 0u; i < helpers; ++i) {
+                    _queue.emplace_back([state]() { drain(state); });
+                }
+            }
+            _wakeCondition.notify_all();
+        }
+
+        drain(state);
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->doneCondition.wait(lock, [&state]() { return state->completed == state->count; });
+
+        if (state->error)
+            std::rethrow_exception(state->error);
+    }
+
+    void job_system::run(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(std::move(task));
+        }
+        _wakeCondition.notify_one();
+    }
+
+    std::future<void> job_system::runAsync(std::function<void()> task) {
+        // std::function needs a copyable target, the packaged task isn't
+        auto packagedTask = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> future = packagedTask->get_future();
+        run([packagedTask]() { (*packagedTask)(); });
+        return future;
+    }
+
+    void job_system::workerMain() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wakeCondition.wait(lock, [this]() { return _stopping || !_queue.empty(); });
+                if (_stopping && _queue.empty())
+                    return;
+
+                task = std::move(_queue.front());
+                _queue.pop_front();
+            }
+
+            task();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // A fixed pool of worker threads. parallelFor() spreads its iterations over the workers and the calling thread
+    // and only returns once all of them have run; the first exception thrown by an iteration is rethrown to the
+    // caller. run() queues a task without waiting for it; tasks must not throw, and any still queued when the pool
+    // is destroyed are run before the workers exit. runAsync() does the same but hands back a future that rethrows
+    // whatever the task threw.
+    class job_system {
+    public:
+        explicit job_system(uint32_t workerCount = getDefaultWorkerCount());
+        ~job_system();
+
+        job_system(const job_system&) = delete;
+        job_system& operator=(const job_system&) = delete;
+
+        // worker threads plus the calling thread
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(_workers.size()) + 1u; }
+
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+        void run(std::function<void()> task);
+        std::future<void> runAsync(std::function<void()> task);
+
+        static uint32_t getDefaultWorkerCount();
+
+    private:
+        std::deque<std::function<void()>> _queue;
+        std::mutex _mutex;
+        bool _stopping;
+        std::condition_variable _wakeCondition;
+        std::vector<std::thread> _workers;
+
+        void workerMain();
+    };
+}
@@ -0,0 +1,25 @@
+#include "json.h"
+
+#include <cstdio>
+
+namespace vulkan_tutorial {
+    void writeJsonString(std::ostream& out, const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            unsigned char code = static_cast<unsigned char>(c);
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            }
+            else if (code < 0x20u) {
+                // formatted by hand so the caller's stream flags stay untouched
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(code));
+                out << escaped;
+            }
+            else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace vulkan_tutorial {
+    // Writes value as a quoted JSON string, escaping quotes, backslashes and control characters.
+    void writeJsonString(std::ostream& out, const std::string& value);
+}
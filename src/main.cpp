@@ -1,3 +1,4 @@
+#include "app_options.h"
 #include "hello_triangle_app.h"
 #include "scoped_glfw_window.h"
 
@@ -5,8 +6,19 @@
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-    vulkan_tutorial::hello_triangle_app app;
+int main(int argc, char** argv) {
+    vulkan_tutorial::app_options options;
+
+    try {
+        options = vulkan_tutorial::app_options::parse(argc, argv);
+    }
+    catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << std::endl;
+        vulkan_tutorial::app_options::printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    vulkan_tutorial::hello_triangle_app app(options);
 
     try {
         app.run();
@@ -0,0 +1,84 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+#include <utility>
+
+namespace vulkan_tutorial {
+    mapped_file::mapped_file()
+      : _data {nullptr},
+        _opened {false},
+        _size {0u}
+    {}
+
+    mapped_file::mapped_file(const std::string& path)
+      : mapped_file()
+    {
+        open(path);
+    }
+
+    mapped_file::mapped_file(mapped_file&& other) noexcept
+      : _data {std::exchange(other._data, nullptr)},
+        _opened {std::exchange(other._opened, false)},
+        _size {std::exchange(other._size, 0u)}
+    {}
+
+    mapped_file::~mapped_file() {
+        close();
+    }
+
+    mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+        if (this != &other) {
+            close();
+            _data = std::exchange(other._data, nullptr);
+            _opened = std::exchange(other._opened, false);
+            _size = std::exchange(other._size, 0u);
+        }
+        return *this;
+    }
+
+    void mapped_file::close() {
+        if (_data != nullptr)
+            munmap(const_cast<char*>(_data), _size);
+
+        _data = nullptr;
+        _opened = false;
+        _size = 0u;
+    }
+
+    void mapped_file::open(const std::string& path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("failed to open " + path);
+
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0) {
+            ::close(fd);
+            throw std::runtime_error("failed to stat " + path);
+        }
+
+        _opened = true;
+        _size = static_cast<size_t>(fileStat.st_size);
+        if (_size == 0u) {
+            ::close(fd);
+            return;
+        }
+
+        void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            _opened = false;
+            _size = 0u;
+            throw std::runtime_error("failed to map " + path);
+        }
+
+        madvise(data, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const char*>(data);
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace vulkan_tutorial {
+    // Read-only memory mapping of a whole file. Move-only; the mapping is released on destruction.
+    class mapped_file {
+    public:
+        mapped_file();
+        explicit mapped_file(const std::string& path);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file(mapped_file&& other) noexcept;
+        mapped_file& operator=(mapped_file&& other) noexcept;
+
+        void close();
+        void open(const std::string& path);
+
+        const char* data() const { return _data; }
+        bool isOpen() const { return _opened; }
+        size_t size() const { return _size; }
+
+    private:
+        const char* _data;
+        bool _opened;
+        size_t _size;
+    };
+}
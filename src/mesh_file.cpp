@@ -0,0 +1,150 @@
+#include "mesh_file.h"
+#include "asset_file.h"
+
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1u) / alignment * alignment;
+    }
+}
+
+namespace vulkan_tutorial {
+    mesh_file::mesh_file()
+      : _file {},
+        _indices {nullptr},
+        _indexCount {0u},
+        _ownedIndices {},
+        _ownedVertices {},
+        _vertices {nullptr},
+        _vertexCount {0u}
+    {}
+
+    void mesh_file::assign(std::vector<vertex> vertices, std::vector<uint32_t> indices) {
+        close();
+
+        _ownedVertices = std::move(vertices);
+        _ownedIndices = std::move(indices);
+        _vertices = _ownedVertices.data();
+        _vertexCount = _ownedVertices.size();
+        _indices = _ownedIndices.data();
+        _indexCount = _ownedIndices.size();
+    }
+
+    void mesh_file::close() {
+        _file.close();
+        _indices = nullptr;
+        _indexCount = 0u;
+        _ownedIndices.clear();
+        _ownedVertices.clear();
+        _vertices = nullptr;
+        _vertexCount = 0u;
+    }
+
+    mesh_file::file_header mesh_file::makeHeader(
+        const std::string& sourcePath,
+        size_t vertexCount,
+        size_t indexCount
+    ) {
+        auto attributeDescriptions = vertex::getAttributeDescriptions();
+        static_assert(attributeDescriptions.size() <= MAX_ATTRIBUTES, "too many vertex attributes for the mesh file");
+
+        file_header header = {};
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        // a missing source is fine, the cache can be shipped on its own
+        statAssetFile(sourcePath, header.sourceSize, header.sourceModifiedTime);
+        header.vertexStride = vertex::getBindingDescription().stride;
+        header.attributeCount = static_cast<uint32_t>(attributeDescriptions.size());
+        for (size_t i = 0; i < attributeDescriptions.size(); ++i) {
+            header.attributes[i].location = attributeDescriptions[i].location;
+            header.attributes[i].format = static_cast<uint32_t>(attributeDescriptions[i].format);
+            header.attributes[i].offset = attributeDescriptions[i].offset;
+        }
+        header.indexSize = sizeof(uint32_t);
+        header.vertexCount = vertexCount;
+        header.vertexOffset = alignUp(sizeof(file_header), PAYLOAD_ALIGNMENT);
+        header.indexCount = indexCount;
+        header.indexOffset = alignUp(header.vertexOffset + vertexCount * header.vertexStride, PAYLOAD_ALIGNMENT);
+        return header;
+    }
+
+    bool mesh_file::open(const std::string& path, const std::string& sourcePath) {
+        close();
+
+        uint64_t fileSize = 0u;
+        int64_t fileModifiedTime = 0;
+        if (!statAssetFile(path, fileSize, fileModifiedTime))
+            return false;
+
+        mapped_file file(path);
+        if (file.size() < sizeof(file_header)) {
+            std::cout << path << " is truncated, ignoring it" << std::endl;
+            return false;
+        }
+
+        file_header header;
+        memcpy(&header, file.data(), sizeof(header));
+
+        uint64_t sourceSize = 0u;
+        int64_t sourceModifiedTime = 0;
+        file_header expected = makeHeader(sourcePath, header.vertexCount, header.indexCount);
+        if (header.magic != expected.magic
+            || header.version != expected.version
+            || header.vertexStride != expected.vertexStride
+            || header.attributeCount != expected.attributeCount
+            || memcmp(header.attributes, expected.attributes, sizeof(header.attributes)) != 0
+            || header.indexSize != expected.indexSize
+        ) {
+            std::cout << path << " was written with a different format or vertex layout, ignoring it" << std::endl;
+            return false;
+        }
+
+        if (statAssetFile(sourcePath, sourceSize, sourceModifiedTime)
+            && (header.sourceSize != sourceSize || header.sourceModifiedTime != sourceModifiedTime)
+        ) {
+            std::cout << path << " is older than " << sourcePath << ", ignoring it" << std::endl;
+            return false;
+        }
+
+        if (header.vertexOffset != expected.vertexOffset
+            || header.indexOffset != expected.indexOffset
+            || header.indexOffset + header.indexCount * header.indexSize != file.size()
+        ) {
+            std::cout << path << " is truncated, ignoring it" << std::endl;
+            return false;
+        }
+
+        const char* payload = file.data() + header.vertexOffset;
+        if (computeAssetChecksum(payload, file.size() - header.vertexOffset) != header.checksum) {
+            std::cout << path << " is corrupt, ignoring it" << std::endl;
+            return false;
+        }
+
+        _file = std::move(file);
+        _vertices = reinterpret_cast<const vertex*>(_file.data() + header.vertexOffset);
+        _vertexCount = header.vertexCount;
+        _indices = reinterpret_cast<const uint32_t*>(_file.data() + header.indexOffset);
+        _indexCount = header.indexCount;
+        return true;
+    }
+
+    void mesh_file::write(
+        const std::string& path,
+        const std::string& sourcePath,
+        const std::vector<vertex>& vertices,
+        const std::vector<uint32_t>& indices
+    ) {
+        file_header header = makeHeader(sourcePath, vertices.size(), indices.size());
+
+        std::vector<char> data(header.indexOffset + indices.size() * sizeof(uint32_t), 0);
+        memcpy(data.data() + header.vertexOffset, vertices.data(), vertices.size() * sizeof(vertex));
+        memcpy(data.data() + header.indexOffset, indices.data(), indices.size() * sizeof(uint32_t));
+        header.checksum = computeAssetChecksum(data.data() + header.vertexOffset, data.size() - header.vertexOffset);
+        memcpy(data.data(), &header, sizeof(header));
+
+        writeAssetFile(path, data.data(), data.size());
+    }
+}
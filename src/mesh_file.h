@@ -0,0 +1,79 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Versioned binary container for an already deduplicated, indexed mesh. The header records the vertex layout
+    // and the size and modification time of the model it was converted from; the vertex and index payloads are
+    // aligned so they can be copied straight out of the memory mapping into a staging buffer.
+    class mesh_file {
+    public:
+        mesh_file();
+
+        mesh_file(const mesh_file&) = delete;
+        mesh_file& operator=(const mesh_file&) = delete;
+
+        // Maps the file at path. Returns false if it doesn't exist, is out of date with respect to sourcePath, was
+        // written with a different vertex layout or fails its checksum.
+        bool open(const std::string& path, const std::string& sourcePath);
+        // Holds the mesh in memory instead, for when no cache file could be written.
+        void assign(std::vector<vertex> vertices, std::vector<uint32_t> indices);
+        void close();
+
+        static void write(
+            const std::string& path,
+            const std::string& sourcePath,
+            const std::vector<vertex>& vertices,
+            const std::vector<uint32_t>& indices);
+
+        const uint32_t* getIndices() const { return _indices; }
+        size_t getIndexCount() const { return _indexCount; }
+        const vertex* getVertices() const { return _vertices; }
+        size_t getVertexCount() const { return _vertexCount; }
+
+    private:
+        static const uint32_t FILE_MAGIC = 0x534d5456u; // "VTMS"
+        // 2: indices and vertices are ordered by mesh_optimizer
+        static const uint32_t FILE_VERSION = 2u;
+        static const uint32_t MAX_ATTRIBUTES = 8u;
+        static const uint64_t PAYLOAD_ALIGNMENT = 64u;
+
+        struct attribute_descriptor {
+            uint32_t location;
+            uint32_t format;
+            uint32_t offset;
+        };
+
+        struct file_header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceSize;
+            int64_t sourceModifiedTime;
+            uint32_t vertexStride;
+            uint32_t attributeCount;
+            attribute_descriptor attributes[MAX_ATTRIBUTES];
+            uint32_t indexSize;
+            uint32_t reserved;
+            uint64_t vertexCount;
+            uint64_t vertexOffset;
+            uint64_t indexCount;
+            uint64_t indexOffset;
+            uint64_t checksum;
+        };
+
+        mapped_file _file;
+        const uint32_t* _indices;
+        size_t _indexCount;
+        std::vector<uint32_t> _ownedIndices;
+        std::vector<vertex> _ownedVertices;
+        const vertex* _vertices;
+        size_t _vertexCount;
+
+        static file_header makeHeader(const std::string& sourcePath, size_t vertexCount, size_t indexCount);
+    };
+}
@@ -0,0 +1,326 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    // scoring constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    const float CACHE_DECAY_POWER = 1.5f;
+    const float LAST_TRIANGLE_SCORE = 0.75f;
+    const float VALENCE_BOOST_SCALE = 2.0f;
+    const float VALENCE_BOOST_POWER = 0.5f;
+
+    // Clusters are also cut after this many triangles, so large connected meshes still have something to sort.
+    const size_t MAX_CLUSTER_TRIANGLES = 512u;
+
+    const uint32_t NOT_REMAPPED = std::numeric_limits<uint32_t>::max();
+
+    double secondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+    }
+}
+
+namespace vulkan_tutorial {
+    mesh_optimizer::mesh_optimizer(bool reorderForOverdraw)
+      : _reorderForOverdraw {reorderForOverdraw},
+        _stats {}
+    {}
+
+    vertex_cache_stats mesh_optimizer::analyzeVertexCache(
+        const std::vector<uint32_t>& indices,
+        size_t vertexCount,
+        uint32_t cacheSize
+    ) {
+        vertex_cache_stats stats = {};
+        if (indices.empty() || vertexCount == 0u)
+            return stats;
+
+        // a vertex is in the cache while it was pushed no more than cacheSize misses ago
+        std::vector<size_t> pushedAt(vertexCount, 0u);
+        size_t misses = 0u;
+        for (uint32_t index : indices) {
+            if (pushedAt[index] == 0u || misses - pushedAt[index] >= cacheSize) {
+                ++misses;
+                pushedAt[index] = misses;
+            }
+        }
+
+        stats.acmr = static_cast<double>(misses) / static_cast<double>(indices.size() / 3u);
+        stats.atvr = static_cast<double>(misses) / static_cast<double>(vertexCount);
+        return stats;
+    }
+
+    std::vector<sub_mesh> mesh_optimizer::splitForShortIndices(const uint32_t* indices, size_t indexCount) {
+        const uint32_t maxSpan = std::numeric_limits<uint16_t>::max();
+
+        std::vector<sub_mesh> subMeshes;
+        size_t first = 0u;
+        uint32_t minIndex = std::numeric_limits<uint32_t>::max();
+        uint32_t maxIndex = 0u;
+        for (size_t i = 0; i + 3u <= indexCount; i += 3u) {
+            uint32_t triangleMin = std::min({ indices[i], indices[i + 1u], indices[i + 2u] });
+            uint32_t triangleMax = std::max({ indices[i], indices[i + 1u], indices[i + 2u] });
+            if (triangleMax - triangleMin > maxSpan)
+                return {};
+
+            if (i > first
+                && std::max(maxIndex, triangleMax) - std::min(minIndex, triangleMin) > maxSpan
+            ) {
+                subMeshes.push_back(sub_mesh {
+                    static_cast<uint32_t>(first),
+                    static_cast<uint32_t>(i - first),
+                    static_cast<int32_t>(minIndex) });
+                first = i;
+                minIndex = std::numeric_limits<uint32_t>::max();
+                maxIndex = 0u;
+            }
+
+            minIndex = std::min(minIndex, triangleMin);
+            maxIndex = std::max(maxIndex, triangleMax);
+        }
+
+        if (indexCount > first) {
+            subMeshes.push_back(sub_mesh {
+                static_cast<uint32_t>(first),
+                static_cast<uint32_t>(indexCount - first),
+                static_cast<int32_t>(minIndex) });
+        }
+        return subMeshes;
+    }
+
+    void mesh_optimizer::optimize(std::vector<vertex>& vertices, std::vector<uint32_t>& indices) {
+        if (indices.size() % 3u != 0u)
+            throw std::invalid_argument("mesh_optimizer expects a triangle list");
+
+        _stats = {};
+        _stats.triangleCount = indices.size() / 3u;
+        _stats.vertexCount = vertices.size();
+        _stats.before = analyzeVertexCache(indices, vertices.size(), STATS_CACHE_SIZE);
+
+        auto startTime = std::chrono::high_resolution_clock::now();
+        std::vector<size_t> clusters = optimizeVertexCache(indices, vertices.size());
+        _stats.clusterCount = clusters.size();
+        _stats.cacheSeconds = secondsSince(startTime);
+
+        if (_reorderForOverdraw) {
+            startTime = std::chrono::high_resolution_clock::now();
+            optimizeOverdraw(vertices, indices, clusters);
+            _stats.overdrawSeconds = secondsSince(startTime);
+        }
+
+        startTime = std::chrono::high_resolution_clock::now();
+        optimizeVertexFetch(vertices, indices);
+        _stats.fetchSeconds = secondsSince(startTime);
+
+        _stats.vertexCount = vertices.size();
+        _stats.after = analyzeVertexCache(indices, vertices.size(), STATS_CACHE_SIZE);
+    }
+
+    void mesh_optimizer::optimizeOverdraw(
+        const std::vector<vertex>& vertices,
+        std::vector<uint32_t>& indices,
+        const std::vector<size_t>& clusters
+    ) const {
+        size_t triangleCount = indices.size() / 3u;
+
+        struct cluster_info {
+            size_t begin;
+            size_t end;
+            glm::vec3 normal;
+            glm::vec3 centroid;
+            float area;
+            float sortKey;
+        };
+
+        std::vector<cluster_info> infos(clusters.size());
+        glm::vec3 meshCentroid(0.0f, 0.0f, 0.0f);
+        float meshArea = 0.0f;
+        for (size_t i = 0; i < clusters.size(); ++i) {
+            auto& info = infos[i];
+            info.begin = clusters[i];
+            info.end = i + 1u < clusters.size() ? clusters[i + 1u] : triangleCount;
+            info.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+            info.centroid = glm::vec3(0.0f, 0.0f, 0.0f);
+            info.area = 0.0f;
+            info.sortKey = 0.0f;
+
+            for (size_t t = info.begin; t < info.end; ++t) {
+                const glm::vec3& a = vertices[indices[3u * t + 0u]].pos;
+                const glm::vec3& b = vertices[indices[3u * t + 1u]].pos;
+                const glm::vec3& c = vertices[indices[3u * t + 2u]].pos;
+
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float area = glm::length(normal);
+                info.normal = info.normal + normal;
+                info.centroid = info.centroid + (a + b + c) * (area / 3.0f);
+                info.area += area;
+            }
+
+            meshCentroid = meshCentroid + info.centroid;
+            meshArea += info.area;
+        }
+        if (meshArea > 0.0f)
+            meshCentroid = meshCentroid / meshArea;
+
+        // the further out a cluster sits along its own normal, the more of the mesh it can hide
+        for (auto& info : infos) {
+            float normalLength = glm::length(info.normal);
+            if (info.area > 0.0f && normalLength > 0.0f)
+                info.sortKey = glm::dot(info.centroid / info.area - meshCentroid, info.normal / normalLength);
+        }
+        std::stable_sort(infos.begin(), infos.end(), [](const cluster_info& a, const cluster_info& b) {
+            return a.sortKey > b.sortKey;
+        });
+
+        std::vector<uint32_t> sorted;
+        sorted.reserve(indices.size());
+        for (const auto& info : infos) {
+            sorted.insert(sorted.end(), indices.begin() + 3u * info.begin, indices.begin() + 3u * info.end);
+        }
+        indices = std::move(sorted);
+    }
+
+    std::vector<size_t> mesh_optimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) const {
+        size_t triangleCount = indices.size() / 3u;
+        std::vector<size_t> clusters;
+        if (triangleCount == 0u)
+            return clusters;
+
+        float cacheScores[CACHE_SIZE];
+        for (uint32_t i = 0u; i < CACHE_SIZE; ++i) {
+            cacheScores[i] = i < 3u
+                ? LAST_TRIANGLE_SCORE
+                : std::pow(1.0f - static_cast<float>(i - 3u) / static_cast<float>(CACHE_SIZE - 3u), CACHE_DECAY_POWER);
+        }
+        auto vertexScore = [&cacheScores](int32_t cachePosition, uint32_t remainingTriangles) {
+            if (remainingTriangles == 0u)
+                return -1.0f;
+
+            float score = cachePosition < 0 ? 0.0f : cacheScores[cachePosition];
+            return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+        };
+
+        // every vertex owns a slice of vertexTriangles, its first remainingTriangles entries are not yet emitted
+        std::vector<uint32_t> remainingTriangles(vertexCount, 0u);
+        for (uint32_t index : indices) {
+            ++remainingTriangles[index];
+        }
+        std::vector<size_t> firstTriangle(vertexCount + 1u, 0u);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            firstTriangle[v + 1u] = firstTriangle[v] + remainingTriangles[v];
+        }
+        std::vector<uint32_t> vertexTriangles(indices.size());
+        {
+            std::vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                vertexTriangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+            }
+        }
+
+        std::vector<int32_t> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v) {
+            vertexScores[v] = vertexScore(-1, remainingTriangles[v]);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            triangleScores[t] = vertexScores[indices[3u * t]]
+                + vertexScores[indices[3u * t + 1u]]
+                + vertexScores[indices[3u * t + 2u]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> optimized(indices.size());
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> nextCache;
+        cache.reserve(CACHE_SIZE + 3u);
+        nextCache.reserve(CACHE_SIZE + 3u);
+
+        size_t nextUnemitted = 0u;
+        int64_t best = -1;
+        for (size_t emittedCount = 0u; emittedCount < triangleCount; ++emittedCount) {
+            // nothing in the cache is left to draw, so start over wherever the input order is
+            if (best < 0 || emittedCount - clusters.back() >= MAX_CLUSTER_TRIANGLES) {
+                if (best < 0) {
+                    while (emitted[nextUnemitted])
+                        ++nextUnemitted;
+                    best = static_cast<int64_t>(nextUnemitted);
+                }
+                clusters.push_back(emittedCount);
+            }
+
+            size_t triangle = static_cast<size_t>(best);
+            emitted[triangle] = true;
+
+            nextCache.clear();
+            for (uint32_t corner = 0u; corner < 3u; ++corner) {
+                uint32_t v = indices[3u * triangle + corner];
+                optimized[3u * emittedCount + corner] = v;
+
+                uint32_t* triangles = vertexTriangles.data() + firstTriangle[v];
+                uint32_t* last = triangles + remainingTriangles[v] - 1u;
+                *std::find(triangles, last, static_cast<uint32_t>(triangle)) = *last;
+                --remainingTriangles[v];
+
+                if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end())
+                    nextCache.push_back(v);
+            }
+            auto emittedEnd = nextCache.end();
+            for (uint32_t v : cache) {
+                if (std::find(nextCache.begin(), emittedEnd, v) == emittedEnd)
+                    nextCache.push_back(v);
+            }
+
+            // rescore everything that moved in the cache, including what just fell out of it
+            for (size_t i = 0; i < nextCache.size(); ++i) {
+                uint32_t v = nextCache[i];
+                cachePositions[v] = i < CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+                float score = vertexScore(cachePositions[v], remainingTriangles[v]);
+                float delta = score - vertexScores[v];
+                vertexScores[v] = score;
+                for (uint32_t j = 0u; j < remainingTriangles[v]; ++j) {
+                    triangleScores[vertexTriangles[firstTriangle[v] + j]] += delta;
+                }
+            }
+            if (nextCache.size() > CACHE_SIZE)
+                nextCache.resize(CACHE_SIZE);
+            std::swap(cache, nextCache);
+
+            best = -1;
+            float bestScore = -std::numeric_limits<float>::max();
+            for (uint32_t v : cache) {
+                for (uint32_t j = 0u; j < remainingTriangles[v]; ++j) {
+                    uint32_t candidate = vertexTriangles[firstTriangle[v] + j];
+                    if (triangleScores[candidate] > bestScore) {
+                        bestScore = triangleScores[candidate];
+                        best = candidate;
+                    }
+                }
+            }
+        }
+
+        indices = std::move(optimized);
+        return clusters;
+    }
+
+    void mesh_optimizer::optimizeVertexFetch(std::vector<vertex>& vertices, std::vector<uint32_t>& indices) const {
+        std::vector<uint32_t> remap(vertices.size(), NOT_REMAPPED);
+        std::vector<vertex> remapped;
+        remapped.reserve(vertices.size());
+
+        for (uint32_t& index : indices) {
+            if (remap[index] == NOT_REMAPPED) {
+                remap[index] = static_cast<uint32_t>(remapped.size());
+                remapped.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        // vertices no triangle uses are dropped
+        vertices = std::move(remapped);
+    }
+}
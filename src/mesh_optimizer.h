@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Post-transform vertex cache efficiency of an index order, simulated with a FIFO cache. ACMR is the number of
+    // vertices transformed per triangle (0.5 at best on a regular grid, 3 at worst), ATVR per unique vertex (1 at
+    // best).
+    struct vertex_cache_stats {
+        double acmr;
+        double atvr;
+    };
+
+    // A run of triangles whose indices, once vertexOffset is subtracted, fit in 16 bits.
+    struct sub_mesh {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        int32_t vertexOffset;
+    };
+
+    struct mesh_optimize_stats {
+        size_t triangleCount;
+        size_t vertexCount;
+        size_t clusterCount;
+        vertex_cache_stats before;
+        vertex_cache_stats after;
+        double cacheSeconds;
+        double overdrawSeconds;
+        double fetchSeconds;
+    };
+
+    // Reorders an indexed triangle list for the GPU. Triangles are first ordered for the post-transform vertex
+    // cache with Tom Forsyth's linear-speed algorithm. Optionally, the runs of triangles between cache restarts are
+    // then sorted so that the ones facing away from the mesh center, which tend to occlude the rest, are drawn first.
+    // Last, vertices are renumbered in order of first use so the vertex fetches walk memory forwards.
+    class mesh_optimizer {
+    public:
+        // cache size the statistics are simulated with, the smallest found on current desktop GPUs
+        static const uint32_t STATS_CACHE_SIZE = 16u;
+
+        explicit mesh_optimizer(bool reorderForOverdraw = true);
+
+        void optimize(std::vector<vertex>& vertices, std::vector<uint32_t>& indices);
+
+        const mesh_optimize_stats& getStats() const { return _stats; }
+
+        static vertex_cache_stats analyzeVertexCache(
+            const std::vector<uint32_t>& indices,
+            size_t vertexCount,
+            uint32_t cacheSize);
+        // Cuts the triangle list wherever the span of vertices referenced since the last cut would no longer fit in
+        // 16-bit indices. No vertex is duplicated, so this works best on vertices in order of first use; a single
+        // triangle spanning too many vertices leaves nothing to split and an empty result.
+        static std::vector<sub_mesh> splitForShortIndices(const uint32_t* indices, size_t indexCount);
+
+    private:
+        // size of the LRU cache the triangle order is optimized for
+        static const uint32_t CACHE_SIZE = 32u;
+
+        bool _reorderForOverdraw;
+        mesh_optimize_stats _stats;
+
+        // Returns the index of the first triangle of every cluster.
+        std::vector<size_t> optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) const;
+        void optimizeOverdraw(
+            const std::vector<vertex>& vertices,
+            std::vector<uint32_t>& indices,
+            const std::vector<size_t>& clusters) const;
+        void optimizeVertexFetch(std::vector<vertex>& vertices, std::vector<uint32_t>& indices) const;
+    };
+}
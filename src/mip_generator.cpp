@@ -0,0 +1,96 @@
+#include "mip_generator.h"
+
+#define STB_IMAGE_RESIZE_STATIC
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    mip_generator::mip_generator(job_system& jobs, mip_filter filter)
+      : _filter {filter},
+        _jobs {jobs}
+    {}
+
+    texture_image mip_generator::generate(const uint8_t* pixels, uint32_t width, uint32_t height) {
+        texture_image image = {};
+        image.format = VK_FORMAT_R8G8B8A8_UNORM;
+        image.width = width;
+        image.height = height;
+
+        uint64_t dataSize = 0u;
+        uint32_t levelCount = getLevelCount(width, height);
+        for (uint32_t i = 0u; i < levelCount; ++i) {
+            texture_level level = {};
+            level.width = std::max(width >> i, 1u);
+            level.height = std::max(height >> i, 1u);
+            level.offset = (dataSize + LEVEL_ALIGNMENT - 1u) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+            level.size = static_cast<uint64_t>(level.width) * level.height * 4u;
+            image.levels.push_back(level);
+
+            dataSize = level.offset + level.size;
+        }
+
+        image.data.resize(dataSize);
+        memcpy(image.data.data(), pixels, image.levels[0].size);
+
+        for (uint32_t i = 1u; i < levelCount; ++i) {
+            const texture_level& source = image.levels[i - 1u];
+            const texture_level& target = image.levels[i];
+            const auto* input = reinterpret_cast<const unsigned char*>(image.data.data() + source.offset);
+            auto* output = reinterpret_cast<unsigned char*>(image.data.data() + target.offset);
+
+            uint32_t strips = std::max(std::min(
+                _jobs.getThreadCount() * 4u,
+                target.height / MIN_ROWS_PER_STRIP), 1u);
+            uint32_t rowsPerStrip = (target.height + strips - 1u) / strips;
+            float xScale = static_cast<float>(target.width) / static_cast<float>(source.width);
+            float yScale = static_cast<float>(target.height) / static_cast<float>(source.height);
+            stbir_filter filter = _filter == mip_filter::mitchell ? STBIR_FILTER_MITCHELL : STBIR_FILTER_BOX;
+
+            // each strip only filters the source rows under its own output rows plus a margin for the filter
+            // support, which gives exactly the same result as resizing the whole level in one go
+            _jobs.parallelFor(strips, [&, input, output](uint32_t strip) {
+                uint32_t firstRow = strip * rowsPerStrip;
+                uint32_t endRow = std::min(firstRow + rowsPerStrip, target.height);
+                if (firstRow >= endRow)
+                    return;
+
+                int64_t firstSourceRow = static_cast<int64_t>(std::floor(firstRow / yScale)) - FILTER_MARGIN;
+                int64_t endSourceRow = static_cast<int64_t>(std::ceil(endRow / yScale)) + FILTER_MARGIN;
+                uint32_t sourceFirst = static_cast<uint32_t>(std::max<int64_t>(firstSourceRow, 0));
+                uint32_t sourceEnd = static_cast<uint32_t>(std::min<int64_t>(endSourceRow, source.height));
+
+                int result = stbir_resize_subpixel(
+                    input + static_cast<size_t>(sourceFirst) * source.width * 4u,
+                    static_cast<int>(source.width), static_cast<int>(sourceEnd - sourceFirst),
+                    static_cast<int>(source.width * 4u),
+                    output + static_cast<size_t>(firstRow) * target.width * 4u,
+                    static_cast<int>(target.width), static_cast<int>(endRow - firstRow),
+                    static_cast<int>(target.width * 4u),
+                    STBIR_TYPE_UINT8,
+                    4, 3, 0,
+                    STBIR_EDGE_CLAMP, STBIR_EDGE_CLAMP,
+                    filter, filter,
+                    STBIR_COLORSPACE_LINEAR, nullptr,
+                    xScale, yScale,
+                    0.0f, static_cast<float>(firstRow) - static_cast<float>(sourceFirst) * yScale);
+                if (result == 0)
+                    throw std::runtime_error("failed to resize mip level");
+            });
+        }
+
+        return image;
+    }
+
+    uint32_t mip_generator::getLevelCount(uint32_t width, uint32_t height) {
+        uint32_t levelCount = 1u;
+        while ((std::max(width, height) >> levelCount) > 0u) {
+            ++levelCount;
+        }
+        return levelCount;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "job_system.h"
+#include "texture_file.h"
+#include <cstdint>
+
+namespace vulkan_tutorial {
+    // box is a plain 2x2 average, the same as the GPU blits it replaces; mitchell is sharper but several times
+    // slower, so it is meant for textures that are baked once.
+    enum class mip_filter {
+        box,
+        mitchell
+    };
+
+    // Builds the full mip chain of an RGBA8 image on the CPU, so textures no longer depend on the device being able
+    // to blit (and linearly filter) their format. Each level is filtered from the one above it with
+    // stb_image_resize, split into horizontal strips that are resized in parallel.
+    class mip_generator {
+    public:
+        static const uint64_t LEVEL_ALIGNMENT = 16u;
+
+        mip_generator(job_system& jobs, mip_filter filter);
+
+        // Returns an R8G8B8A8_UNORM texture_image holding every level from width x height down to 1x1.
+        texture_image generate(const uint8_t* pixels, uint32_t width, uint32_t height);
+
+        static uint32_t getLevelCount(uint32_t width, uint32_t height);
+
+    private:
+        static const int64_t FILTER_MARGIN = 8;
+        static const uint32_t MIN_ROWS_PER_STRIP = 32u;
+
+        mip_filter _filter;
+        job_system& _jobs;
+    };
+}
@@ -0,0 +1,379 @@
+#include "obj_loader.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    using vulkan_tutorial::vertex;
+
+    const int64_t MISSING_INDEX = INT64_MIN;
+
+    // Indices relative to the end of the attribute list (negative in the file) can only be resolved once the number
+    // of attributes in the preceding chunks is known, so they are stored relative to the start of the chunk.
+    const uint8_t POSITION_RELATIVE = 1u;
+    const uint8_t TEX_COORD_RELATIVE = 2u;
+
+    struct face_corner {
+        int64_t position;
+        int64_t texCoord;
+        uint8_t relative;
+    };
+
+    struct obj_chunk {
+        const char* begin;
+        const char* end;
+        std::vector<float> positions;
+        std::vector<float> texCoords;
+        std::vector<face_corner> corners;
+        size_t positionBase;
+        size_t texCoordBase;
+        size_t cornerBase;
+    };
+
+    bool isSpace(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    const char* skipSpaces(const char* p, const char* end) {
+        while (p < end && isSpace(*p))
+            ++p;
+        return p;
+    }
+
+    // Decimal float parser for the subset OBJ exporters produce: optional sign, digits, fraction and exponent.
+    // Accumulates the significand in an integer and scales once, which is several times faster than strtof.
+    const char* parseFloat(const char* p, const char* end, float& value) {
+        static const double powersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+            1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        p = skipSpaces(p, end);
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negative = *p == '-';
+            ++p;
+        }
+
+        uint64_t significand = 0u;
+        int exponent = 0;
+        int digits = 0;
+        const char* start = p;
+
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (digits < 19) {
+                significand = significand * 10u + static_cast<uint64_t>(*p - '0');
+                if (significand != 0u)
+                    ++digits;
+            }
+            else {
+                ++exponent;
+            }
+            ++p;
+        }
+
+        if (p < end && *p == '.') {
+            ++p;
+            while (p < end && *p >= '0' && *p <= '9') {
+                if (digits < 19) {
+                    significand = significand * 10u + static_cast<uint64_t>(*p - '0');
+                    if (significand != 0u)
+                        ++digits;
+                    --exponent;
+                }
+                ++p;
+            }
+        }
+
+        if (p == start)
+            throw std::runtime_error("malformed number in OBJ file");
+
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool negativeExponent = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                negativeExponent = *p == '-';
+                ++p;
+            }
+            int explicitExponent = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                explicitExponent = std::min(explicitExponent * 10 + (*p - '0'), 1000);
+                ++p;
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+        }
+
+        double result = static_cast<double>(significand);
+        while (exponent > 22) {
+            result *= 1e22;
+            exponent -= 22;
+        }
+        while (exponent < -22) {
+            result /= 1e22;
+            exponent += 22;
+        }
+        result = exponent >= 0 ? result * powersOfTen[exponent] : result / powersOfTen[-exponent];
+
+        value = static_cast<float>(negative ? -result : result);
+        return p;
+    }
+
+    const char* parseIndex(const char* p, const char* end, size_t localCount, int64_t& index, bool& relative) {
+        bool negative = false;
+        if (p < end && *p == '-') {
+            negative = true;
+            ++p;
+        }
+
+        const char* start = p;
+        int64_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            ++p;
+        }
+
+        if (p == start || value == 0)
+            throw std::runtime_error("malformed face index in OBJ file");
+
+        relative = negative;
+        index = negative ? static_cast<int64_t>(localCount) - value : value - 1;
+        return p;
+    }
+
+    const char* parseCorner(const char* p, const char* end, const obj_chunk& chunk, face_corner& corner) {
+        bool relative = false;
+        p = parseIndex(p, end, chunk.positions.size() / 3u, corner.position, relative);
+        corner.relative = relative ? POSITION_RELATIVE : 0u;
+        corner.texCoord = MISSING_INDEX;
+
+        if (p < end && *p == '/') {
+            ++p;
+            if (p < end && *p != '/') {
+                p = parseIndex(p, end, chunk.texCoords.size() / 2u, corner.texCoord, relative);
+                corner.relative |= relative ? TEX_COORD_RELATIVE : 0u;
+            }
+
+            // normals aren't used
+            if (p < end && *p == '/') {
+                ++p;
+                while (p < end && !isSpace(*p) && *p != '\r' && *p != '\n')
+                    ++p;
+            }
+        }
+
+        return p;
+    }
+
+    void parseChunk(obj_chunk& chunk) {
+        std::vector<face_corner> polygon;
+
+        const char* p = chunk.begin;
+        while (p < chunk.end) {
+            const char* lineEnd = static_cast<const char*>(memchr(p, '\n', chunk.end - p));
+            if (lineEnd == nullptr)
+                lineEnd = chunk.end;
+
+            p = skipSpaces(p, lineEnd);
+
+            if (lineEnd - p > 2 && p[0] == 'v' && isSpace(p[1])) {
+                float x, y, z;
+                p = parseFloat(p + 2, lineEnd, x);
+                p = parseFloat(p, lineEnd, y);
+                p = parseFloat(p, lineEnd, z);
+                chunk.positions.push_back(x);
+                chunk.positions.push_back(y);
+                chunk.positions.push_back(z);
+            }
+            else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 't' && isSpace(p[2])) {
+                float u, v;
+                p = parseFloat(p + 3, lineEnd, u);
+                p = parseFloat(p, lineEnd, v);
+                chunk.texCoords.push_back(u);
+                chunk.texCoords.push_back(v);
+            }
+            else if (lineEnd - p > 2 && p[0] == 'f' && isSpace(p[1])) {
+                polygon.clear();
+                p = skipSpaces(p + 2, lineEnd);
+                while (p < lineEnd && *p != '\r') {
+                    face_corner corner;
+                    p = parseCorner(p, lineEnd, chunk, corner);
+                    polygon.push_back(corner);
+                    p = skipSpaces(p, lineEnd);
+                }
+
+                // triangulate as a fan, like tinyobj does
+                for (size_t i = 2; i < polygon.size(); ++i) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[i - 1]);
+                    chunk.corners.push_back(polygon[i]);
+                }
+            }
+
+            p = lineEnd + 1;
+        }
+    }
+
+    int64_t resolve(int64_t index, bool relative, size_t base) {
+        if (index == MISSING_INDEX || !relative)
+            return index;
+        return index + static_cast<int64_t>(base);
+    }
+
+    uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    uint32_t floatBits(float f) {
+        // +0.0 and -0.0 compare equal, so they have to hash equal too
+        f += 0.0f;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t hashVertex(const vertex& v) {
+        uint64_t h = mix((static_cast<uint64_t>(floatBits(v.pos.x)) << 32) | floatBits(v.pos.y));
+        h = mix(h ^ ((static_cast<uint64_t>(floatBits(v.pos.z)) << 32) | floatBits(v.texCoord.x)));
+        h = mix(h ^ floatBits(v.texCoord.y));
+        return h;
+    }
+}
+
+namespace vulkan_tutorial {
+    obj_loader::obj_loader(job_system& jobs)
+      : _jobs {jobs},
+        _stats {}
+    {}
+
+    void obj_loader::load(const std::string& path, std::vector<vertex>& vertices, std::vector<uint32_t>& indices) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        mapped_file file(path);
+        const char* data = file.data();
+        const char* dataEnd = data + file.size();
+
+        // a few chunks per thread so that uneven chunks even out
+        size_t chunkCount = std::max<size_t>(1u, std::min<size_t>(_jobs.getThreadCount() * 4u, file.size() / (64u * 1024u)));
+        std::vector<obj_chunk> chunks(chunkCount);
+
+        const char* chunkBegin = data;
+        for (size_t i = 0; i < chunkCount; ++i) {
+            const char* chunkEnd = std::max(chunkBegin, data + file.size() * (i + 1) / chunkCount);
+            if (chunkEnd < dataEnd) {
+                const char* newline = static_cast<const char*>(memchr(chunkEnd, '\n', dataEnd - chunkEnd));
+                chunkEnd = newline == nullptr ? dataEnd : newline + 1;
+            }
+
+            chunks[i].begin = chunkBegin;
+            chunks[i].end = chunkEnd;
+            chunkBegin = chunkEnd;
+        }
+
+        _jobs.parallelFor(static_cast<uint32_t>(chunkCount), [&chunks](uint32_t i) {
+            parseChunk(chunks[i]);
+        });
+
+        size_t positionCount = 0u, texCoordCount = 0u, cornerCount = 0u;
+        for (auto& chunk : chunks) {
+            chunk.positionBase = positionCount;
+            chunk.texCoordBase = texCoordCount;
+            chunk.cornerBase = cornerCount;
+            positionCount += chunk.positions.size() / 3u;
+            texCoordCount += chunk.texCoords.size() / 2u;
+            cornerCount += chunk.corners.size();
+        }
+
+        std::vector<float> positions(positionCount * 3u);
+        std::vector<float> texCoords(texCoordCount * 2u);
+        for (const auto& chunk : chunks) {
+            std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3u);
+            std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase * 2u);
+        }
+
+        auto parseEndTime = std::chrono::high_resolution_clock::now();
+
+        // expand every corner into a full vertex and hash it in parallel, then merge sequentially so that vertices
+        // are numbered in order of first use
+        std::vector<vertex> corners(cornerCount);
+        std::vector<uint64_t> hashes(cornerCount);
+
+        _jobs.parallelFor(static_cast<uint32_t>(chunkCount), [&](uint32_t i) {
+            const auto& chunk = chunks[i];
+            for (size_t c = 0; c < chunk.corners.size(); ++c) {
+                const auto& corner = chunk.corners[c];
+                int64_t position = resolve(corner.position, corner.relative & POSITION_RELATIVE, chunk.positionBase);
+                int64_t texCoord = resolve(corner.texCoord, corner.relative & TEX_COORD_RELATIVE, chunk.texCoordBase);
+                if (position < 0 || position >= static_cast<int64_t>(positionCount)
+                    || (texCoord != MISSING_INDEX && (texCoord < 0 || texCoord >= static_cast<int64_t>(texCoordCount)))
+                ) {
+                    throw std::runtime_error("face index out of range in " + path);
+                }
+
+                vertex& v = corners[chunk.cornerBase + c];
+                v.pos = { positions[3 * position + 0], positions[3 * position + 1], positions[3 * position + 2] };
+                v.texCoord = texCoord == MISSING_INDEX
+                    ? glm::vec2(0.0f, 0.0f)
+                    : glm::vec2(texCoords[2 * texCoord + 0], 1.0f - texCoords[2 * texCoord + 1]);
+                hashes[chunk.cornerBase + c] = hashVertex(v);
+            }
+        });
+
+        size_t tableSize = 16u;
+        while (tableSize < cornerCount * 2u)
+            tableSize *= 2u;
+        const size_t tableMask = tableSize - 1u;
+
+        // slot holds the vertex index plus one, zero marks an empty slot
+        std::vector<uint32_t> table(tableSize, 0u);
+        std::vector<uint64_t> vertexHashes;
+        vertexHashes.reserve(cornerCount / 4u);
+
+        size_t firstVertex = vertices.size();
+        vertices.reserve(firstVertex + cornerCount / 4u);
+        indices.reserve(indices.size() + cornerCount);
+
+        for (size_t c = 0; c < cornerCount; ++c) {
+            uint64_t hash = hashes[c];
+            size_t slot = static_cast<size_t>(hash) & tableMask;
+
+            while (true) {
+                uint32_t entry = table[slot];
+                if (entry == 0u) {
+                    uint32_t index = static_cast<uint32_t>(vertices.size());
+                    table[slot] = index - static_cast<uint32_t>(firstVertex) + 1u;
+                    vertexHashes.push_back(hash);
+                    vertices.push_back(corners[c]);
+                    indices.push_back(index);
+                    break;
+                }
+
+                uint32_t local = entry - 1u;
+                if (vertexHashes[local] == hash && vertices[firstVertex + local] == corners[c]) {
+                    indices.push_back(static_cast<uint32_t>(firstVertex + local));
+                    break;
+                }
+
+                slot = (slot + 1u) & tableMask;
+            }
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        _stats.fileBytes = file.size();
+        _stats.positionCount = positionCount;
+        _stats.texCoordCount = texCoordCount;
+        _stats.indexCount = cornerCount;
+        _stats.vertexCount = vertices.size() - firstVertex;
+        _stats.parseSeconds = std::chrono::duration<double, std::chrono::seconds::period>(parseEndTime - startTime).count();
+        _stats.dedupSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - parseEndTime).count();
+    }
+}
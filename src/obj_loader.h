@@ -0,0 +1,36 @@
+#pragma once
+
+#include "job_system.h"
+#include "vertex.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct obj_load_stats {
+        size_t fileBytes;
+        size_t positionCount;
+        size_t texCoordCount;
+        size_t indexCount;
+        size_t vertexCount;
+        double parseSeconds;
+        double dedupSeconds;
+    };
+
+    // Loads the positions and texture coordinates of a Wavefront OBJ file into an indexed triangle list. The file
+    // is memory mapped and split into line-aligned chunks that are parsed in parallel; identical vertices are
+    // merged through an open-addressing hash table and numbered in order of first use.
+    class obj_loader {
+    public:
+        explicit obj_loader(job_system& jobs);
+
+        void load(const std::string& path, std::vector<vertex>& vertices, std::vector<uint32_t>& indices);
+
+        const obj_load_stats& getStats() const { return _stats; }
+
+    private:
+        job_system& _jobs;
+        obj_load_stats _stats;
+    };
+}
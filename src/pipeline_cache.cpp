@@ -0,0 +1,176 @@
+#include "pipeline_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    uint64_t fnv1a(const char* data, size_t size) {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint8_t>(data[i]);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // The blob returned by vkGetPipelineCacheData starts with its own header, see VK_PIPELINE_CACHE_HEADER_VERSION_ONE.
+    bool isCompatibleCacheData(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties) {
+        const size_t headerSize = 4u * sizeof(uint32_t) + VK_UUID_SIZE;
+        if (data.size() < headerSize)
+            return false;
+
+        uint32_t fields[4];
+        memcpy(fields, data.data(), sizeof(fields));
+
+        return fields[0] >= headerSize
+            && fields[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+            && fields[2] == properties.vendorID
+            && fields[3] == properties.deviceID
+            && memcmp(data.data() + sizeof(fields), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+}
+
+namespace vulkan_tutorial {
+    pipeline_cache::pipeline_cache()
+      : _cache {VK_NULL_HANDLE},
+        _device {VK_NULL_HANDLE},
+        _deviceProperties {},
+        _path {}
+    {}
+
+    pipeline_cache::~pipeline_cache() {
+        destroy();
+    }
+
+    void pipeline_cache::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyPipelineCache(_device, _cache, nullptr);
+
+        _cache = VK_NULL_HANDLE;
+        _device = VK_NULL_HANDLE;
+        _deviceProperties = {};
+        _path.clear();
+    }
+
+    void pipeline_cache::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path) {
+        destroy();
+
+        _device = device;
+        _path = path;
+        vkGetPhysicalDeviceProperties(physicalDevice, &_deviceProperties);
+
+        std::vector<char> initialData = readCacheData();
+
+        VkPipelineCacheCreateInfo cacheInfo = {};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        cacheInfo.initialDataSize = initialData.size();
+        cacheInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+        VkResult result = vkCreatePipelineCache(_device, &cacheInfo, nullptr, &_cache);
+        if (result != VK_SUCCESS && !initialData.empty()) {
+            std::cout << "driver rejected pipeline cache " << _path << ", starting empty" << std::endl;
+            cacheInfo.initialDataSize = 0u;
+            cacheInfo.pInitialData = nullptr;
+            result = vkCreatePipelineCache(_device, &cacheInfo, nullptr, &_cache);
+        }
+        if (result != VK_SUCCESS) {
+            _device = VK_NULL_HANDLE;
+            throw std::runtime_error("failed to create pipeline cache");
+        }
+    }
+
+    pipeline_cache::file_header pipeline_cache::makeHeader(uint64_t dataSize, uint64_t checksum) const {
+        file_header header = {};
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.vendorID = _deviceProperties.vendorID;
+        header.deviceID = _deviceProperties.deviceID;
+        header.driverVersion = _deviceProperties.driverVersion;
+        memcpy(header.pipelineCacheUUID, _deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.dataSize = dataSize;
+        header.checksum = checksum;
+        return header;
+    }
+
+    std::vector<char> pipeline_cache::readCacheData() const {
+        std::ifstream file(_path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            std::cout << "no pipeline cache at " << _path << std::endl;
+            return {};
+        }
+
+        uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        file_header header = {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        file_header expected = makeHeader(header.dataSize, header.checksum);
+        if (!file || memcmp(&header, &expected, sizeof(header)) != 0) {
+            std::cout << "pipeline cache " << _path << " was written by another device or driver, ignoring it" << std::endl;
+            return {};
+        }
+
+        // the header check compares dataSize with itself, so check it against the file before allocating
+        if (header.dataSize != fileSize - sizeof(header)) {
+            std::cout << "pipeline cache " << _path << " is corrupt, ignoring it" << std::endl;
+            return {};
+        }
+
+        std::vector<char> data(static_cast<size_t>(header.dataSize));
+        file.read(data.data(), data.size());
+        if (!file
+            || fnv1a(data.data(), data.size()) != header.checksum
+            || !isCompatibleCacheData(data, _deviceProperties)
+        ) {
+            std::cout << "pipeline cache " << _path << " is corrupt, ignoring it" << std::endl;
+            return {};
+        }
+
+        std::cout << "loaded pipeline cache " << _path << " (" << data.size() << " bytes)" << std::endl;
+        return data;
+    }
+
+    void pipeline_cache::save() const {
+        if (_cache == VK_NULL_HANDLE)
+            return;
+
+        size_t dataSize = 0u;
+        VkResult result = vkGetPipelineCacheData(_device, _cache, &dataSize, nullptr);
+        if (result != VK_SUCCESS || dataSize == 0u)
+            return;
+
+        std::vector<char> data(dataSize);
+        result = vkGetPipelineCacheData(_device, _cache, &dataSize, data.data());
+        if (result != VK_SUCCESS)
+            return;
+        data.resize(dataSize);
+
+        file_header header = makeHeader(data.size(), fnv1a(data.data(), data.size()));
+
+        // write next to the real file and swap it in, so an interrupted save never leaves a truncated cache behind
+        std::string tempPath = _path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(data.data(), data.size());
+            if (!file) {
+                std::cerr << "failed to write pipeline cache " << tempPath << std::endl;
+                return;
+            }
+        }
+
+        if (std::rename(tempPath.c_str(), _path.c_str()) != 0) {
+            std::cerr << "failed to replace pipeline cache " << _path << std::endl;
+            std::remove(tempPath.c_str());
+            return;
+        }
+
+        std::cout << "saved pipeline cache " << _path << " (" << data.size() << " bytes)" << std::endl;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Wraps a VkPipelineCache that is seeded from a file on startup and written back on shutdown. The file carries
+    // its own header with the vendor, device, driver version and pipelineCacheUUID it was produced on plus a
+    // checksum of the payload; a file that doesn't match the current device is ignored and rebuilt from scratch.
+    class pipeline_cache {
+    public:
+        pipeline_cache();
+        ~pipeline_cache();
+
+        pipeline_cache(const pipeline_cache&) = delete;
+        pipeline_cache& operator=(const pipeline_cache&) = delete;
+
+        void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path);
+        void destroy();
+        void save() const;
+
+        VkPipelineCache get() const { return _cache; }
+
+    private:
+        struct file_header {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t vendorID;
+            uint32_t deviceID;
+            uint32_t driverVersion;
+            uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+            uint32_t reserved;
+            uint64_t dataSize;
+            uint64_t checksum;
+        };
+
+        static const uint32_t FILE_MAGIC = 0x43505456u; // "VTPC"
+        static const uint32_t FILE_VERSION = 1u;
+
+        VkPipelineCache _cache;
+        VkDevice _device;
+        VkPhysicalDeviceProperties _deviceProperties;
+        std::string _path;
+
+        file_header makeHeader(uint64_t dataSize, uint64_t checksum) const;
+        std::vector<char> readCacheData() const;
+    };
+}
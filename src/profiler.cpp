@@ -0,0 +1,291 @@
+#include "profiler.h"
+#include "json.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    const uint32_t QUERIES_PER_FRAME = 2u;
+}
+
+namespace vulkan_tutorial {
+    profile_stats profile_stats::fromSamples(std::string name, std::vector<double> samples) {
+        profile_stats stats = {};
+        stats.name = std::move(name);
+        stats.totalCount = samples.size();
+        stats.windowCount = static_cast<uint32_t>(samples.size());
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            size_t index = static_cast<size_t>(p / 100.0 * static_cast<double>(samples.size() - 1u) + 0.5);
+            return samples[index];
+        };
+
+        double total = 0.0;
+        for (double sample : samples) {
+            total += sample;
+        }
+
+        stats.min = samples.front();
+        stats.mean = total / static_cast<double>(samples.size());
+        stats.p50 = percentile(50.0);
+        stats.p95 = percentile(95.0);
+        stats.p99 = percentile(99.0);
+        stats.max = samples.back();
+        return stats;
+    }
+
+    profiler::scope::scope(profiler& owner, const char* name)
+      : _index {owner.findScope(name)},
+        _owner {owner},
+        _startTime {std::chrono::high_resolution_clock::now()}
+    {}
+
+    profiler::scope::~scope() {
+        auto endTime = std::chrono::high_resolution_clock::now();
+        _owner.record(
+            _index,
+            false,
+            _owner.sinceEpoch(_startTime),
+            std::chrono::duration<double, std::milli>(endTime - _startTime).count());
+    }
+
+    profiler::profiler()
+      : _device {VK_NULL_HANDLE},
+        _epoch {std::chrono::high_resolution_clock::now()},
+        _frameQueriesWritten {},
+        _frameStartTime {},
+        _gpuFrameScope {0u},
+        _gpuTimeOffset {0.0},
+        _histories {},
+        _queryPool {VK_NULL_HANDLE},
+        _timestampPeriod {0.0},
+        _timestampMask {0u},
+        _traceEnabled {false},
+        _traceEvents {}
+    {}
+
+    profiler::~profiler() {
+        destroy();
+    }
+
+    void profiler::beginFrame() {
+        auto now = std::chrono::high_resolution_clock::now();
+        if (_frameStartTime != std::chrono::high_resolution_clock::time_point()) {
+            record(
+                findScope("frame"),
+                false,
+                sinceEpoch(_frameStartTime),
+                std::chrono::duration<double, std::milli>(now - _frameStartTime).count());
+        }
+        _frameStartTime = now;
+    }
+
+    void profiler::beginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (_queryPool == VK_NULL_HANDLE)
+            return;
+
+        uint32_t firstQuery = frameIndex * QUERIES_PER_FRAME;
+        vkCmdResetQueryPool(commandBuffer, _queryPool, firstQuery, QUERIES_PER_FRAME);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, _queryPool, firstQuery);
+    }
+
+    void profiler::calibrate(upload_context& context) {
+        if (_queryPool == VK_NULL_HANDLE)
+            return;
+
+        // the query after the per-frame ones is reserved for this
+        uint32_t query = static_cast<uint32_t>(_frameQueriesWritten.size()) * QUERIES_PER_FRAME;
+        VkCommandBuffer commandBuffer = context.getCommandBuffer();
+        vkCmdResetQueryPool(commandBuffer, _queryPool, query, 1u);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _queryPool, query);
+        context.waitIdle();
+        double cpuTime = sinceEpoch(std::chrono::high_resolution_clock::now());
+
+        uint64_t timestamp = 0u;
+        VkResult result = vkGetQueryPoolResults(
+            _device, _queryPool, query, 1u,
+            sizeof(timestamp), &timestamp, sizeof(timestamp),
+            VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to read the calibration timestamp");
+
+        _gpuTimeOffset = cpuTime - static_cast<double>(timestamp & _timestampMask) * _timestampPeriod / 1000.0;
+    }
+
+    void profiler::collectGpuTimes(uint32_t frameIndex) {
+        if (_queryPool == VK_NULL_HANDLE || !_frameQueriesWritten[frameIndex])
+            return;
+
+        uint64_t timestamps[QUERIES_PER_FRAME] = {};
+        VkResult result = vkGetQueryPoolResults(
+            _device, _queryPool, frameIndex * QUERIES_PER_FRAME, QUERIES_PER_FRAME,
+            sizeof(timestamps), timestamps, sizeof(timestamps[0]),
+            VK_QUERY_RESULT_64_BIT);
+        _frameQueriesWritten[frameIndex] = false;
+        if (result != VK_SUCCESS)
+            return;
+
+        uint64_t begin = timestamps[0] & _timestampMask;
+        uint64_t end = timestamps[1] & _timestampMask;
+        record(
+            _gpuFrameScope,
+            true,
+            static_cast<double>(begin) * _timestampPeriod / 1000.0 + _gpuTimeOffset,
+            static_cast<double>((end - begin) & _timestampMask) * _timestampPeriod / 1000000.0);
+    }
+
+    void profiler::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyQueryPool(_device, _queryPool, nullptr);
+
+        _device = VK_NULL_HANDLE;
+        _frameQueriesWritten.clear();
+        _gpuTimeOffset = 0.0;
+        _queryPool = VK_NULL_HANDLE;
+        _timestampPeriod = 0.0;
+        _timestampMask = 0u;
+    }
+
+    void profiler::endGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+        if (_queryPool == VK_NULL_HANDLE)
+            return;
+
+        vkCmdWriteTimestamp(
+            commandBuffer,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            _queryPool,
+            frameIndex * QUERIES_PER_FRAME + 1u);
+        _frameQueriesWritten[frameIndex] = true;
+    }
+
+    uint32_t profiler::findScope(const char* name) {
+        for (size_t i = 0; i < _histories.size(); ++i) {
+            if (_histories[i].name == name)
+                return static_cast<uint32_t>(i);
+        }
+
+        scope_history history = {};
+        history.name = name;
+        history.samples.reserve(WINDOW_SIZE);
+        _histories.push_back(std::move(history));
+        return static_cast<uint32_t>(_histories.size() - 1u);
+    }
+
+    std::vector<profile_stats> profiler::getStats() const {
+        std::vector<profile_stats> allStats;
+        for (const auto& history : _histories) {
+            if (history.samples.empty())
+                continue;
+
+            profile_stats stats = profile_stats::fromSamples(history.name, history.samples);
+            stats.totalCount = history.totalCount;
+            allStats.push_back(std::move(stats));
+        }
+        return allStats;
+    }
+
+    void profiler::init(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        uint32_t queueFamilyIndex,
+        uint32_t frameCount,
+        bool traceEnabled
+    ) {
+        destroy();
+
+        _device = device;
+        _frameQueriesWritten.assign(frameCount, false);
+        _gpuFrameScope = findScope("gpu render pass");
+        _traceEnabled = traceEnabled;
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+        uint32_t queueFamilyCount = 0u;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+        if (validBits == 0u)
+            return;
+
+        _timestampPeriod = deviceProperties.limits.timestampPeriod;
+        _timestampMask = validBits >= 64u ? ~0ull : (1ull << validBits) - 1u;
+
+        VkQueryPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = frameCount * QUERIES_PER_FRAME + 1u;
+
+        VkResult result = vkCreateQueryPool(_device, &poolInfo, nullptr, &_queryPool);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create timestamp query pool");
+    }
+
+    void profiler::printStats(std::ostream& out) const {
+        out << "profile (ms over the last " << WINDOW_SIZE << " samples):" << std::endl;
+        for (const auto& stats : getStats()) {
+            out << "  " << stats.name << ": mean " << stats.mean
+                << ", p50 " << stats.p50
+                << ", p95 " << stats.p95
+                << ", p99 " << stats.p99
+                << ", max " << stats.max << std::endl;
+        }
+    }
+
+    void profiler::record(uint32_t scope, bool gpu, double startMicroseconds, double durationMilliseconds) {
+        auto& history = _histories[scope];
+        if (history.samples.size() < WINDOW_SIZE)
+            history.samples.push_back(durationMilliseconds);
+        else
+            history.samples[history.next] = durationMilliseconds;
+        history.next = (history.next + 1u) % WINDOW_SIZE;
+        history.totalCount += 1u;
+
+        if (_traceEnabled && _traceEvents.size() < MAX_TRACE_EVENTS)
+            _traceEvents.push_back(trace_event { scope, gpu, startMicroseconds, durationMilliseconds * 1000.0 });
+    }
+
+    void profiler::reset() {
+        for (auto& history : _histories) {
+            history.samples.clear();
+            history.totalCount = 0u;
+            history.next = 0u;
+        }
+    }
+
+    double profiler::sinceEpoch(std::chrono::high_resolution_clock::time_point time) const {
+        return std::chrono::duration<double, std::micro>(time - _epoch).count();
+    }
+
+    void profiler::writeChromeTrace(const std::string& path) const {
+        std::ofstream file(path);
+        if (!file)
+            throw std::runtime_error("failed to open " + path + " for writing");
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+        for (const auto& event : _traceEvents) {
+            file << ",\n{\"name\":";
+            writeJsonString(file, _histories[event.scope].name);
+            file << ",\"cat\":\"" << (event.gpu ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                << (event.gpu ? 2 : 1) << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << '}';
+        }
+        file << "\n]}\n";
+
+        if (!file)
+            throw std::runtime_error("failed to write " + path);
+    }
+}
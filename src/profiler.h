@@ -0,0 +1,115 @@
+#pragma once
+
+#include "upload_context.h"
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Percentiles over the most recent samples of one scope, in milliseconds.
+    struct profile_stats {
+        std::string name;
+        uint64_t totalCount;
+        uint32_t windowCount;
+        double min;
+        double mean;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+
+        static profile_stats fromSamples(std::string name, std::vector<double> samples);
+    };
+
+    // Times named CPU scopes and the GPU time of each frame's render pass. Every scope keeps a rolling window of its
+    // latest samples for percentile statistics; optionally every sample is also kept as a Chrome trace event
+    // (chrome://tracing, Perfetto), with GPU timestamps mapped onto the CPU clock. Single-threaded: scopes are meant
+    // for the render thread.
+    class profiler {
+    public:
+        static const uint32_t WINDOW_SIZE = 512u;
+        static const size_t MAX_TRACE_EVENTS = 1u << 20;
+
+        // Ends its scope when it goes out of scope.
+        class scope {
+        public:
+            scope(profiler& owner, const char* name);
+            ~scope();
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+
+        private:
+            uint32_t _index;
+            profiler& _owner;
+            std::chrono::high_resolution_clock::time_point _startTime;
+        };
+
+        profiler();
+        ~profiler();
+
+        profiler(const profiler&) = delete;
+        profiler& operator=(const profiler&) = delete;
+
+        // GPU timing is left off if the queue family can't write timestamps.
+        void init(
+            VkPhysicalDevice physicalDevice,
+            VkDevice device,
+            uint32_t queueFamilyIndex,
+            uint32_t frameCount,
+            bool traceEnabled);
+        void destroy();
+
+        // Submits a timestamp on the context's queue and waits for it, to line the GPU clock up with the CPU's.
+        void calibrate(upload_context& context);
+
+        // Closes the previous frame's "frame" sample.
+        void beginFrame();
+        // Drops the samples taken so far from the statistics, the trace keeps them.
+        void reset();
+        // Reads back the GPU times of the last frame that used frameIndex; its fence must have been waited on.
+        void collectGpuTimes(uint32_t frameIndex);
+        void beginGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+        void endGpuFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+        std::vector<profile_stats> getStats() const;
+        void printStats(std::ostream& out) const;
+        void writeChromeTrace(const std::string& path) const;
+
+    private:
+        struct scope_history {
+            std::string name;
+            std::vector<double> samples;
+            uint64_t totalCount;
+            uint32_t next;
+        };
+
+        struct trace_event {
+            uint32_t scope;
+            bool gpu;
+            double start;
+            double duration;
+        };
+
+        VkDevice _device;
+        std::chrono::high_resolution_clock::time_point _epoch;
+        std::vector<bool> _frameQueriesWritten;
+        std::chrono::high_resolution_clock::time_point _frameStartTime;
+        uint32_t _gpuFrameScope;
+        // CPU time in microseconds since _epoch minus GPU time in microseconds
+        double _gpuTimeOffset;
+        std::vector<scope_history> _histories;
+        VkQueryPool _queryPool;
+        double _timestampPeriod;
+        uint64_t _timestampMask;
+        bool _traceEnabled;
+        std::vector<trace_event> _traceEvents;
+
+        uint32_t findScope(const char* name);
+        void record(uint32_t scope, bool gpu, double start, double duration);
+        double sinceEpoch(std::chrono::high_resolution_clock::time_point time) const;
+    };
+}
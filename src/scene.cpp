@@ -0,0 +1,84 @@
+#include "scene.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    scene::scene()
+      : _meshes {},
+        _instances {}
+    {}
+
+    uint32_t scene::addMesh(const std::string& sourcePath) {
+        // the converted mesh is cached next to its source
+        std::string cachePath = sourcePath.substr(0u, sourcePath.find_last_of('.')) + ".mesh";
+        _meshes.push_back(scene_mesh { sourcePath, cachePath });
+        return static_cast<uint32_t>(_meshes.size() - 1u);
+    }
+
+    void scene::addGrid(uint32_t count, float spacing) {
+        if (_meshes.empty())
+            throw std::logic_error("a scene needs a mesh before it can be filled");
+
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        float center = static_cast<float>(side - 1u) * spacing / 2.0f;
+        uint32_t meshCount = static_cast<uint32_t>(_meshes.size());
+
+        // cell i holds mesh i % meshCount; walking the cells mesh by mesh keeps every instance an append
+        _instances.reserve(_instances.size() + count);
+        for (uint32_t mesh = 0u; mesh < meshCount; ++mesh) {
+            for (uint32_t i = mesh; i < count; i += meshCount) {
+                glm::vec3 position(
+                    static_cast<float>(i % side) * spacing - center,
+                    static_cast<float>(i / side) * spacing - center,
+                    0.0f);
+                addInstance(mesh, glm::translate(glm::mat4(1.0f), position));
+            }
+        }
+    }
+
+    void scene::addInstance(uint32_t mesh, const glm::mat4& transform) {
+        if (mesh >= _meshes.size())
+            throw std::out_of_range("instance of an unknown mesh");
+
+        // instances added in mesh order are appended, anything else is inserted after the last one of its mesh
+        if (_instances.empty() || _instances.back().mesh <= mesh) {
+            _instances.push_back(scene_instance { mesh, transform });
+            return;
+        }
+
+        auto position = std::upper_bound(
+            _instances.begin(),
+            _instances.end(),
+            mesh,
+            [](uint32_t m, const scene_instance& instance) { return m < instance.mesh; });
+        _instances.insert(position, scene_instance { mesh, transform });
+    }
+
+    std::vector<instance_batch> scene::getBatches() const {
+        std::vector<instance_batch> batches;
+        for (uint32_t i = 0u; i < _instances.size(); ++i) {
+            if (batches.empty() || batches.back().mesh != _instances[i].mesh)
+                batches.push_back(instance_batch { _instances[i].mesh, i, 0u });
+            batches.back().instanceCount += 1u;
+        }
+        return batches;
+    }
+
+    float scene::getRadius(const std::vector<float>& meshRadii) const {
+        float radius = 0.0f;
+        for (const auto& instance : _instances) {
+            // conservative for scaled transforms: the longest axis scales the whole mesh radius
+            float scale = std::max({
+                glm::length(glm::vec3(instance.transform[0])),
+                glm::length(glm::vec3(instance.transform[1])),
+                glm::length(glm::vec3(instance.transform[2]))
+            });
+            float distance = glm::length(glm::vec3(instance.transform[3]));
+            radius = std::max(radius, distance + meshRadii[instance.mesh] * scale);
+        }
+        return radius;
+    }
+}
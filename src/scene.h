@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct scene_mesh {
+        std::string sourcePath;
+        std::string cachePath;
+    };
+
+    struct scene_instance {
+        uint32_t mesh;
+        glm::mat4 transform;
+    };
+
+    // A run of consecutive instances of one mesh, drawn with one instanced draw per sub-mesh.
+    struct instance_batch {
+        uint32_t mesh;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    // The meshes to load and every placement of them. Instances are kept grouped by mesh, so the instance data can
+    // be uploaded as is and each mesh drawn with a single batch however many times it is repeated.
+    class scene {
+    public:
+        scene();
+
+        uint32_t addMesh(const std::string& sourcePath);
+        void addInstance(uint32_t mesh, const glm::mat4& transform);
+        // Places count instances on a square grid in the xy plane, centered on the origin, cycling through the
+        // meshes.
+        void addGrid(uint32_t count, float spacing);
+
+        const std::vector<scene_mesh>& getMeshes() const { return _meshes; }
+        const std::vector<scene_instance>& getInstances() const { return _instances; }
+        std::vector<instance_batch> getBatches() const;
+        // Radius around the origin that contains every instance, given the bounding radius of each mesh.
+        float getRadius(const std::vector<float>& meshRadii) const;
+
+    private:
+        std::vector<scene_mesh> _meshes;
+        // sorted by mesh
+        std::vector<scene_instance> _instances;
+    };
+}
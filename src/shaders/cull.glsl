@@ -0,0 +1,65 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 64) in;
+
+struct DrawIndexedIndirectCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances {
+    mat4 transforms[];
+} instances;
+
+layout(std430, binding = 1) writeonly buffer VisibleInstances {
+    mat4 transforms[];
+} visibleInstances;
+
+layout(std430, binding = 2) buffer DrawCounts {
+    uint counts[];
+} drawCounts;
+
+layout(std430, binding = 3) buffer Draws {
+    DrawIndexedIndirectCommand commands[];
+} draws;
+
+layout(push_constant) uniform CullBatch {
+    // xyz inward normal, w distance
+    vec4 frustumPlanes[6];
+    uint instanceBase;
+    uint firstInstance;
+    uint instanceCount;
+    uint batchIndex;
+    uint firstDraw;
+    uint drawCount;
+    float radius;
+} batch;
+
+void main() {
+    uint index = gl_GlobalInvocationID.x;
+    if (index >= batch.instanceCount)
+        return;
+
+    uint instance = batch.firstInstance + index;
+    mat4 transform = instances.transforms[batch.instanceBase + instance];
+
+    vec3 center = transform[3].xyz;
+    float scale = max(max(length(transform[0].xyz), length(transform[1].xyz)), length(transform[2].xyz));
+    float radius = batch.radius * scale;
+    for (int i = 0; i < 6; ++i) {
+        if (dot(batch.frustumPlanes[i].xyz, center) + batch.frustumPlanes[i].w < -radius)
+            return;
+    }
+
+    // the first sub-mesh's draw hands out the slots, the others only count along
+    uint slot = atomicAdd(draws.commands[batch.firstDraw].instanceCount, 1u);
+    for (uint draw = 1u; draw < batch.drawCount; ++draw) {
+        atomicAdd(draws.commands[batch.firstDraw + draw].instanceCount, 1u);
+    }
+    visibleInstances.transforms[batch.firstInstance + slot] = transform;
+    drawCounts.counts[batch.batchIndex] = batch.drawCount;
+}
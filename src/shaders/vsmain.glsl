@@ -5,17 +5,18 @@ layout(binding = 0) uniform UniformBufferObject {
     mat4 model;
     mat4 view;
     mat4 proj;
+    // xy scale, zw offset
+    vec4 texCoordTransform;
 } ubo;
 
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inColor;
-layout(location = 2) in vec2 inTexCoord;
+layout(location = 1) in vec2 inTexCoord;
+// per instance, takes locations 2 to 5
+layout(location = 2) in mat4 inInstanceTransform;
 
-layout(location = 0) out vec3 fragColor;
-layout(location = 1) out vec2 fragTexCoord;
+layout(location = 0) out vec2 fragTexCoord;
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
-    fragColor = inColor;
-    fragTexCoord = inTexCoord;
+    gl_Position = ubo.proj * ubo.view * inInstanceTransform * ubo.model * vec4(inPosition, 1.0);
+    fragTexCoord = inTexCoord * ubo.texCoordTransform.xy + ubo.texCoordTransform.zw;
 }
@@ -0,0 +1,115 @@
+#include "texture_baker.h"
+#include "mip_generator.h"
+
+#define STB_DXT_STATIC
+#define STB_DXT_IMPLEMENTATION
+#include <stb/stb_dxt.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+namespace {
+    const uint32_t BLOCK_DIMENSION = 4u;
+
+    bool isOpaque(const uint8_t* pixels, size_t texelCount) {
+        for (size_t i = 0; i < texelCount; ++i) {
+            if (pixels[i * 4u + 3u] != 255u)
+                return false;
+        }
+        return true;
+    }
+}
+
+namespace vulkan_tutorial {
+    texture_baker::texture_baker(job_system& jobs)
+      : _jobs {jobs},
+        _stats {}
+    {}
+
+    texture_image texture_baker::bake(const uint8_t* pixels, uint32_t width, uint32_t height, bool compress) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        // compressed textures are baked once and cached, so they can afford the better filter
+        mip_generator mips(_jobs, compress ? mip_filter::mitchell : mip_filter::box);
+        texture_image image = mips.generate(pixels, width, height);
+
+        auto mipTime = std::chrono::high_resolution_clock::now();
+
+        if (compress)
+            image = this->compress(image, !isOpaque(pixels, static_cast<size_t>(width) * height));
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+
+        _stats.sourceBytes = static_cast<size_t>(width) * height * 4u;
+        _stats.bakedBytes = image.data.size();
+        _stats.mipSeconds = std::chrono::duration<double>(mipTime - startTime).count();
+        _stats.compressSeconds = std::chrono::duration<double>(endTime - mipTime).count();
+
+        return image;
+    }
+
+    texture_image texture_baker::compress(const texture_image& source, bool alpha) {
+        uint32_t blockSize = alpha ? 16u : 8u;
+
+        texture_image image = {};
+        image.format = alpha ? VK_FORMAT_BC3_UNORM_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+        image.width = source.width;
+        image.height = source.height;
+
+        uint64_t dataSize = 0u;
+        for (const auto& level : source.levels) {
+            uint64_t blocksWide = (level.width + BLOCK_DIMENSION - 1u) / BLOCK_DIMENSION;
+            uint64_t blocksHigh = (level.height + BLOCK_DIMENSION - 1u) / BLOCK_DIMENSION;
+
+            texture_level imageLevel = {};
+            imageLevel.width = level.width;
+            imageLevel.height = level.height;
+            imageLevel.offset = (dataSize + mip_generator::LEVEL_ALIGNMENT - 1u)
+                / mip_generator::LEVEL_ALIGNMENT * mip_generator::LEVEL_ALIGNMENT;
+            imageLevel.size = blocksWide * blocksHigh * blockSize;
+            image.levels.push_back(imageLevel);
+
+            dataSize = imageLevel.offset + imageLevel.size;
+        }
+        image.data.resize(dataSize);
+
+        // stb_dxt fills its lookup tables on first use, which must not race between the workers
+        uint8_t warmupBlock[BLOCK_DIMENSION * BLOCK_DIMENSION * 4u] = {};
+        uint8_t warmupOutput[16u];
+        stb_compress_dxt_block(warmupOutput, warmupBlock, 0, STB_DXT_NORMAL);
+
+        for (size_t i = 0; i < source.levels.size(); ++i) {
+            const texture_level& level = source.levels[i];
+            const uint8_t* input = reinterpret_cast<const uint8_t*>(source.data.data() + level.offset);
+            char* output = image.data.data() + image.levels[i].offset;
+            uint32_t blocksWide = (level.width + BLOCK_DIMENSION - 1u) / BLOCK_DIMENSION;
+            uint32_t blocksHigh = (level.height + BLOCK_DIMENSION - 1u) / BLOCK_DIMENSION;
+
+            _jobs.parallelFor(blocksHigh, [&level, input, output, blocksWide, blockSize, alpha](uint32_t blockY) {
+                uint8_t block[BLOCK_DIMENSION * BLOCK_DIMENSION * 4u];
+
+                for (uint32_t blockX = 0u; blockX < blocksWide; ++blockX) {
+                    // levels smaller than a block are padded by repeating their last row and column
+                    for (uint32_t y = 0u; y < BLOCK_DIMENSION; ++y) {
+                        uint32_t sourceY = std::min(blockY * BLOCK_DIMENSION + y, level.height - 1u);
+                        for (uint32_t x = 0u; x < BLOCK_DIMENSION; ++x) {
+                            uint32_t sourceX = std::min(blockX * BLOCK_DIMENSION + x, level.width - 1u);
+                            memcpy(
+                                block + (y * BLOCK_DIMENSION + x) * 4u,
+                                input + (static_cast<size_t>(sourceY) * level.width + sourceX) * 4u,
+                                4u);
+                        }
+                    }
+
+                    auto* destination = reinterpret_cast<unsigned char*>(
+                        output + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockSize);
+                    stb_compress_dxt_block(destination, block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+                }
+            });
+        }
+
+        return image;
+    }
+}
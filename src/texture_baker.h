@@ -0,0 +1,32 @@
+#pragma once
+
+#include "job_system.h"
+#include "texture_file.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace vulkan_tutorial {
+    struct texture_bake_stats {
+        size_t sourceBytes;
+        size_t bakedBytes;
+        double mipSeconds;
+        double compressSeconds;
+    };
+
+    // Turns a decoded RGBA8 image into a texture_image with a full mip chain generated by mip_generator. When
+    // compressing, every level is then block-compressed in parallel: BC1 when every texel is opaque, BC3 otherwise.
+    class texture_baker {
+    public:
+        explicit texture_baker(job_system& jobs);
+
+        texture_image bake(const uint8_t* pixels, uint32_t width, uint32_t height, bool compress);
+
+        const texture_bake_stats& getStats() const { return _stats; }
+
+    private:
+        job_system& _jobs;
+        texture_bake_stats _stats;
+
+        texture_image compress(const texture_image& source, bool alpha);
+    };
+}
@@ -0,0 +1,122 @@
+#include "texture_file.h"
+#include "asset_file.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1u) / alignment * alignment;
+    }
+}
+
+namespace vulkan_tutorial {
+    texture_file::texture_file()
+      : _data {nullptr},
+        _dataSize {0u},
+        _file {},
+        _image {}
+    {}
+
+    void texture_file::assign(texture_image image) {
+        close();
+
+        _image = std::move(image);
+        _data = _image.data.data();
+        _dataSize = _image.data.size();
+    }
+
+    void texture_file::close() {
+        _data = nullptr;
+        _dataSize = 0u;
+        _file.close();
+        _image = {};
+    }
+
+    bool texture_file::open(const std::string& path, const std::string& sourcePath) {
+        close();
+
+        uint64_t fileSize = 0u;
+        int64_t fileModifiedTime = 0;
+        if (!statAssetFile(path, fileSize, fileModifiedTime))
+            return false;
+
+        mapped_file file(path);
+        if (file.size() < sizeof(file_header)) {
+            std::cout << path << " is truncated, ignoring it" << std::endl;
+            return false;
+        }
+
+        file_header header;
+        memcpy(&header, file.data(), sizeof(header));
+
+        if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+            std::cout << path << " was written with a different format, ignoring it" << std::endl;
+            return false;
+        }
+
+        uint64_t sourceSize = 0u;
+        int64_t sourceModifiedTime = 0;
+        if (statAssetFile(sourcePath, sourceSize, sourceModifiedTime)
+            && (header.sourceSize != sourceSize || header.sourceModifiedTime != sourceModifiedTime)
+        ) {
+            std::cout << path << " is older than " << sourcePath << ", ignoring it" << std::endl;
+            return false;
+        }
+
+        bool levelsInBounds = header.levelCount > 0u && header.levelCount <= MAX_LEVELS;
+        for (uint32_t i = 0u; levelsInBounds && i < header.levelCount; ++i) {
+            levelsInBounds = header.levels[i].offset + header.levels[i].size <= header.dataSize;
+        }
+
+        if (!levelsInBounds
+            || header.dataOffset != alignUp(sizeof(file_header), DATA_ALIGNMENT)
+            || header.dataOffset + header.dataSize != file.size()
+        ) {
+            std::cout << path << " is truncated, ignoring it" << std::endl;
+            return false;
+        }
+
+        const char* data = file.data() + header.dataOffset;
+        if (computeAssetChecksum(data, header.dataSize) != header.checksum) {
+            std::cout << path << " is corrupt, ignoring it" << std::endl;
+            return false;
+        }
+
+        _file = std::move(file);
+        _data = data;
+        _dataSize = header.dataSize;
+        _image.format = static_cast<VkFormat>(header.format);
+        _image.width = header.width;
+        _image.height = header.height;
+        _image.levels.assign(header.levels, header.levels + header.levelCount);
+        return true;
+    }
+
+    void texture_file::write(const std::string& path, const std::string& sourcePath, const texture_image& image) {
+        if (image.levels.empty() || image.levels.size() > MAX_LEVELS)
+            throw std::invalid_argument("unsupported number of texture levels");
+
+        file_header header = {};
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        statAssetFile(sourcePath, header.sourceSize, header.sourceModifiedTime);
+        header.format = static_cast<uint32_t>(image.format);
+        header.width = image.width;
+        header.height = image.height;
+        header.levelCount = static_cast<uint32_t>(image.levels.size());
+        std::copy(image.levels.begin(), image.levels.end(), header.levels);
+        header.dataOffset = alignUp(sizeof(file_header), DATA_ALIGNMENT);
+        header.dataSize = image.data.size();
+        header.checksum = computeAssetChecksum(image.data.data(), image.data.size());
+
+        std::vector<char> data(header.dataOffset + header.dataSize, 0);
+        memcpy(data.data(), &header, sizeof(header));
+        memcpy(data.data() + header.dataOffset, image.data.data(), image.data.size());
+
+        writeAssetFile(path, data.data(), data.size());
+    }
+}
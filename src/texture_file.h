@@ -0,0 +1,79 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct texture_level {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // A texture with its whole mip chain laid out back to back in the format it is uploaded in.
+    struct texture_image {
+        VkFormat format;
+        uint32_t width;
+        uint32_t height;
+        std::vector<texture_level> levels;
+        std::vector<char> data;
+    };
+
+    // Versioned binary container for a baked texture_image. Like mesh_file it records the size and modification
+    // time of the image it was baked from, and the level data is mapped so it can be copied straight into a
+    // staging buffer.
+    class texture_file {
+    public:
+        texture_file();
+
+        texture_file(const texture_file&) = delete;
+        texture_file& operator=(const texture_file&) = delete;
+
+        // Maps the file at path. Returns false if it doesn't exist, is out of date with respect to sourcePath or
+        // fails its checksum.
+        bool open(const std::string& path, const std::string& sourcePath);
+        // Holds the texture in memory instead, for when no baked file could be written.
+        void assign(texture_image image);
+        void close();
+
+        static void write(const std::string& path, const std::string& sourcePath, const texture_image& image);
+
+        const char* getData() const { return _data; }
+        size_t getDataSize() const { return _dataSize; }
+        VkFormat getFormat() const { return _image.format; }
+        uint32_t getHeight() const { return _image.height; }
+        const std::vector<texture_level>& getLevels() const { return _image.levels; }
+        uint32_t getWidth() const { return _image.width; }
+
+    private:
+        static const uint32_t FILE_MAGIC = 0x58545456u; // "VTTX"
+        static const uint32_t FILE_VERSION = 2u;
+        static const uint32_t MAX_LEVELS = 16u;
+        static const uint64_t DATA_ALIGNMENT = 64u;
+
+        struct file_header {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t sourceSize;
+            int64_t sourceModifiedTime;
+            uint32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t levelCount;
+            texture_level levels[MAX_LEVELS];
+            uint64_t dataOffset;
+            uint64_t dataSize;
+            uint64_t checksum;
+        };
+
+        const char* _data;
+        size_t _dataSize;
+        mapped_file _file;
+        texture_image _image;
+    };
+}
@@ -0,0 +1,290 @@
+#include "texture_loader.h"
+#include "texture_baker.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace vulkan_tutorial {
+    texture_loader::texture_loader()
+      : _allocator {nullptr},
+        _completed {nullptr},
+        _compressionSupported {false},
+        _device {VK_NULL_HANDLE},
+        _jobs {},
+        _pendingCount {0u},
+        _ready {},
+        _stopping {false}
+    {}
+
+    texture_loader::~texture_loader() {
+        destroy();
+    }
+
+    void texture_loader::createStagingBuffer(VkDeviceSize size, loaded_texture& texture) {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(_device, &bufferInfo, nullptr, &texture.stagingBuffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create texture staging buffer");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(_device, texture.stagingBuffer, &memRequirements);
+
+        texture.stagingAllocation = _allocator->allocate(
+            memRequirements,
+            _allocator->findMemoryType(
+                memRequirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+            resource_kind::linear);
+
+        result = vkBindBufferMemory(
+            _device,
+            texture.stagingBuffer,
+            texture.stagingAllocation.memory,
+            texture.stagingAllocation.offset);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to bind texture staging memory");
+    }
+
+    void texture_loader::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        // requests that haven't started yet are skipped, the pool waits for the ones that have
+        _stopping = true;
+        _jobs.reset();
+
+        loaded_texture texture;
+        while (poll(texture)) {
+            destroyStagingBuffer(texture);
+        }
+
+        _allocator = nullptr;
+        _compressionSupported = false;
+        _device = VK_NULL_HANDLE;
+        _pendingCount = 0u;
+        _stopping = false;
+    }
+
+    void texture_loader::destroyStagingBuffer(loaded_texture& texture) {
+        vkDestroyBuffer(_device, texture.stagingBuffer, nullptr);
+        _allocator->free(texture.stagingAllocation);
+        texture.stagingBuffer = VK_NULL_HANDLE;
+    }
+
+    void texture_loader::init(
+        VkDevice device,
+        device_memory_allocator* allocator,
+        bool compressionSupported
+    ) {
+        destroy();
+
+        _allocator = allocator;
+        _compressionSupported = compressionSupported;
+        _device = device;
+        _jobs = std::make_unique<job_system>();
+    }
+
+    void texture_loader::load(
+        uint32_t textureIndex,
+        const std::string& sourcePath,
+        const std::string& bakedPath,
+        uint32_t maxInitialExtent
+    ) {
+        ++_pendingCount;
+
+        _jobs->run([this, textureIndex, sourcePath, bakedPath, maxInitialExtent]() {
+            loaded_texture texture = {};
+            texture.textureIndex = textureIndex;
+            texture.path = sourcePath;
+
+            if (_stopping) {
+                texture.error = "loading was cancelled";
+                push(std::move(texture));
+                return;
+            }
+
+            try {
+                loadTexture(sourcePath, bakedPath, maxInitialExtent, texture);
+            }
+            catch (const std::exception& e) {
+                if (texture.stagingBuffer != VK_NULL_HANDLE)
+                    destroyStagingBuffer(texture);
+                texture.error = e.what();
+            }
+
+            push(std::move(texture));
+        });
+    }
+
+    void texture_loader::loadLevels(
+        uint32_t textureIndex,
+        std::shared_ptr<const texture_file> file,
+        uint32_t firstLevel,
+        uint32_t endLevel
+    ) {
+        if (firstLevel >= endLevel || endLevel > file->getLevels().size())
+            throw std::invalid_argument("requested texture levels are out of range");
+
+        ++_pendingCount;
+
+        _jobs->run([this, textureIndex, file, firstLevel, endLevel]() {
+            loaded_texture texture = {};
+            texture.textureIndex = textureIndex;
+            texture.file = file;
+            texture.format = file->getFormat();
+            texture.width = file->getWidth();
+            texture.height = file->getHeight();
+
+            if (_stopping) {
+                texture.error = "loading was cancelled";
+                push(std::move(texture));
+                return;
+            }
+
+            try {
+                stageLevels(firstLevel, endLevel, texture);
+            }
+            catch (const std::exception& e) {
+                if (texture.stagingBuffer != VK_NULL_HANDLE)
+                    destroyStagingBuffer(texture);
+                texture.error = e.what();
+            }
+
+            push(std::move(texture));
+        });
+    }
+
+    void texture_loader::loadTexture(
+        const std::string& sourcePath,
+        const std::string& bakedPath,
+        uint32_t maxInitialExtent,
+        loaded_texture& texture
+    ) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        std::ostringstream description;
+
+        auto file = std::make_shared<texture_file>();
+        if (_compressionSupported && file->open(bakedPath, sourcePath)) {
+            description << "mapped " << bakedPath;
+        }
+        else {
+            int texWidth, texHeight, texChannels;
+            stbi_uc* pixels = stbi_load(sourcePath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+            if (pixels == nullptr)
+                throw std::runtime_error("failed to load texture image " + sourcePath);
+
+            texture_baker baker(*_jobs);
+            texture_image image;
+            try {
+                image = baker.bake(
+                    pixels,
+                    static_cast<uint32_t>(texWidth),
+                    static_cast<uint32_t>(texHeight),
+                    _compressionSupported);
+            }
+            catch (...) {
+                stbi_image_free(pixels);
+                throw;
+            }
+            stbi_image_free(pixels);
+
+            const auto& stats = baker.getStats();
+            description << (_compressionSupported ? "baked " : "read ") << sourcePath
+                << " (" << texChannels << " channels, mips " << stats.mipSeconds * 1000.0
+                << " ms, compression " << stats.compressSeconds * 1000.0 << " ms";
+
+            if (_compressionSupported) {
+                try {
+                    texture_file::write(bakedPath, sourcePath, image);
+                    description << ", wrote " << bakedPath;
+                }
+                catch (const std::runtime_error& error) {
+                    description << ", not cached: " << error.what();
+                }
+            }
+            description << ")";
+
+            file->assign(std::move(image));
+        }
+
+        texture.file = file;
+        texture.format = file->getFormat();
+        texture.width = file->getWidth();
+        texture.height = file->getHeight();
+
+        const auto& levels = file->getLevels();
+        uint32_t levelCount = static_cast<uint32_t>(levels.size());
+        uint32_t firstLevel = 0u;
+        while (firstLevel + 1u < levelCount
+            && std::max(levels[firstLevel].width, levels[firstLevel].height) > maxInitialExtent
+        ) {
+            ++firstLevel;
+        }
+        stageLevels(firstLevel, levelCount, texture);
+
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - startTime;
+        description << ": " << texture.width << 'x' << texture.height << ", " << levelCount << " mips, "
+            << file->getDataSize() / 1024u << " KiB in " << elapsed.count() << " ms";
+        texture.description = description.str();
+    }
+
+    bool texture_loader::poll(loaded_texture& texture) {
+        if (_ready.empty()) {
+            // take everything finished so far in one go; the list is newest first, so reverse it while moving
+            completed_texture* completed = _completed.exchange(nullptr, std::memory_order_acquire);
+            std::deque<loaded_texture> batch;
+            while (completed != nullptr) {
+                batch.push_front(std::move(completed->texture));
+                completed_texture* next = completed->next;
+                delete completed;
+                completed = next;
+            }
+            _ready = std::move(batch);
+        }
+
+        if (_ready.empty())
+            return false;
+
+        texture = std::move(_ready.front());
+        _ready.pop_front();
+        --_pendingCount;
+        return true;
+    }
+
+    void texture_loader::push(loaded_texture texture) {
+        auto* completed = new completed_texture { std::move(texture), nullptr };
+        completed->next = _completed.load(std::memory_order_relaxed);
+        while (!_completed.compare_exchange_weak(
+            completed->next, completed,
+            std::memory_order_release, std::memory_order_relaxed)
+        ) {}
+    }
+
+    void texture_loader::stageLevels(uint32_t firstLevel, uint32_t endLevel, loaded_texture& texture) {
+        // the levels are stored back to back, so any run of them is one contiguous copy
+        const auto& levels = texture.file->getLevels();
+        uint64_t firstOffset = levels[firstLevel].offset;
+        uint64_t size = levels[endLevel - 1u].offset + levels[endLevel - 1u].size - firstOffset;
+
+        createStagingBuffer(size, texture);
+        memcpy(texture.stagingAllocation.mapped, texture.file->getData() + firstOffset, size);
+
+        texture.baseLevel = firstLevel;
+        texture.levels.assign(levels.begin() + firstLevel, levels.begin() + endLevel);
+        for (auto& level : texture.levels) {
+            level.offset -= firstOffset;
+        }
+    }
+}
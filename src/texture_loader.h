@@ -0,0 +1,97 @@
+#pragma once
+
+#include "device_memory_allocator.h"
+#include "job_system.h"
+#include "texture_file.h"
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Levels [baseLevel, baseLevel + levels.size()) of a texture, sitting in a host visible staging buffer ready to
+    // be copied into an image; the level offsets are relative to the staging buffer. file stays open so that the
+    // remaining levels can be requested later. error is set instead if the texture couldn't be loaded, in which
+    // case there is no staging buffer.
+    struct loaded_texture {
+        uint32_t textureIndex;
+        std::string path;
+        std::shared_ptr<const texture_file> file;
+        VkFormat format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t baseLevel;
+        std::vector<texture_level> levels;
+        VkBuffer stagingBuffer;
+        device_allocation stagingAllocation;
+        std::string description;
+        std::string error;
+    };
+
+    // Loads textures on its own pool of threads, so neither startup nor the render loop waits for decoding. Each
+    // request maps the baked texture_file if it is up to date, or decodes and bakes the source image (writing the
+    // baked file for next time), and then fills a staging buffer the worker allocates itself. Only the smallest
+    // levels are staged at first, finer ones follow through loadLevels() as the texture is streamed in. Finished
+    // requests are pushed onto a lock-free list; the render thread takes them with poll() and only has to record
+    // the copy. textureIndex is the caller's and is handed back untouched.
+    class texture_loader {
+    public:
+        texture_loader();
+        ~texture_loader();
+
+        texture_loader(const texture_loader&) = delete;
+        texture_loader& operator=(const texture_loader&) = delete;
+
+        void init(
+            VkDevice device,
+            device_memory_allocator* allocator,
+            bool compressionSupported);
+        void destroy();
+
+        // Stages the levels no larger than maxInitialExtent in either dimension, and at least the last one.
+        void load(
+            uint32_t textureIndex,
+            const std::string& sourcePath,
+            const std::string& bakedPath,
+            uint32_t maxInitialExtent);
+        // Stages levels [firstLevel, endLevel) of a texture loaded before.
+        void loadLevels(
+            uint32_t textureIndex,
+            std::shared_ptr<const texture_file> file,
+            uint32_t firstLevel,
+            uint32_t endLevel);
+        // Hands out one finished texture; the caller owns its staging buffer from then on.
+        bool poll(loaded_texture& texture);
+
+        // requests that haven't been handed out by poll() yet
+        uint32_t getPendingCount() const { return _pendingCount.load(); }
+
+    private:
+        struct completed_texture {
+            loaded_texture texture;
+            completed_texture* next;
+        };
+
+        device_memory_allocator* _allocator;
+        std::atomic<completed_texture*> _completed;
+        bool _compressionSupported;
+        VkDevice _device;
+        std::unique_ptr<job_system> _jobs;
+        std::atomic<uint32_t> _pendingCount;
+        std::deque<loaded_texture> _ready;
+        std::atomic<bool> _stopping;
+
+        void createStagingBuffer(VkDeviceSize size, loaded_texture& texture);
+        void destroyStagingBuffer(loaded_texture& texture);
+        void loadTexture(
+            const std::string& sourcePath,
+            const std::string& bakedPath,
+            uint32_t maxInitialExtent,
+            loaded_texture& texture);
+        void push(loaded_texture texture);
+        void stageLevels(uint32_t firstLevel, uint32_t endLevel, loaded_texture& texture);
+    };
+}
@@ -0,0 +1,149 @@
+#include "texture_residency.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    texture_residency::texture_residency(VkDeviceSize budgetBytes)
+      : _stats {},
+        _textures {}
+    {
+        _stats.budgetBytes = budgetBytes;
+    }
+
+    uint32_t texture_residency::add(const std::vector<texture_level>& levels, uint32_t baseLevel) {
+        if (baseLevel >= levels.size())
+            throw std::invalid_argument("a streamed texture needs at least one resident level");
+
+        streamed_texture texture = {};
+        texture.tailBytes.resize(levels.size() + 1u, 0u);
+        for (size_t i = levels.size(); i > 0u; --i) {
+            texture.tailBytes[i - 1u] = texture.tailBytes[i] + levels[i - 1u].size;
+        }
+        texture.minimumLevel = baseLevel;
+        texture.residentLevel = static_cast<uint32_t>(levels.size());
+        texture.pendingLevel = texture.residentLevel;
+        texture.requestedLevel = baseLevel;
+
+        _textures.push_back(std::move(texture));
+        _stats.textureCount += 1u;
+
+        uint32_t id = static_cast<uint32_t>(_textures.size() - 1u);
+        setResident(id, baseLevel);
+        return id;
+    }
+
+    VkDeviceSize texture_residency::getResidentBytes(uint32_t texture) const {
+        const auto& streamed = _textures[texture];
+        return streamed.tailBytes[streamed.residentLevel];
+    }
+
+    void texture_residency::printStats(std::ostream& out) const {
+        out << "texture residency: " << _stats.textureCount << " textures, "
+            << _stats.residentBytes / 1024u << " KiB resident (peak " << _stats.peakResidentBytes / 1024u << " KiB";
+        if (_stats.budgetBytes > 0u)
+            out << ", budget " << _stats.budgetBytes / 1024u << " KiB";
+        out << "), streamed in " << _stats.levelsStreamedIn << " levels / " << _stats.bytesStreamedIn / 1024u
+            << " KiB, evicted " << _stats.levelsEvicted << " levels / " << _stats.bytesEvicted / 1024u << " KiB"
+            << std::endl;
+    }
+
+    void texture_residency::request(uint32_t texture, uint32_t level, uint64_t frame) {
+        auto& streamed = _textures[texture];
+        if (streamed.lastRequestFrame != frame || level < streamed.requestedLevel)
+            streamed.requestedLevel = std::min(level, streamed.minimumLevel);
+        streamed.lastRequestFrame = frame;
+    }
+
+    void texture_residency::setResident(uint32_t texture, uint32_t baseLevel) {
+        auto& streamed = _textures[texture];
+        if (baseLevel > streamed.minimumLevel)
+            throw std::invalid_argument("cannot evict the levels a streamed texture started out with");
+
+        if (baseLevel < streamed.residentLevel) {
+            _stats.levelsStreamedIn += streamed.residentLevel - baseLevel;
+            _stats.bytesStreamedIn += streamed.tailBytes[baseLevel] - streamed.tailBytes[streamed.residentLevel];
+        }
+        else if (baseLevel > streamed.residentLevel) {
+            _stats.levelsEvicted += baseLevel - streamed.residentLevel;
+            _stats.bytesEvicted += streamed.tailBytes[streamed.residentLevel] - streamed.tailBytes[baseLevel];
+        }
+
+        _stats.residentBytes -= streamed.tailBytes[streamed.residentLevel];
+        _stats.residentBytes += streamed.tailBytes[baseLevel];
+        _stats.peakResidentBytes = std::max(_stats.peakResidentBytes, _stats.residentBytes);
+
+        streamed.pendingLevel = baseLevel;
+        streamed.residentLevel = baseLevel;
+    }
+
+    std::vector<residency_change> texture_residency::update(uint64_t frame) {
+        std::vector<uint32_t> targets(_textures.size());
+        VkDeviceSize targetBytes = 0u;
+        for (size_t i = 0; i < _textures.size(); ++i) {
+            const auto& streamed = _textures[i];
+            bool unused = streamed.lastRequestFrame + UNUSED_FRAMES < frame;
+            targets[i] = unused ? streamed.minimumLevel : streamed.requestedLevel;
+            targetBytes += streamed.tailBytes[targets[i]];
+        }
+
+        // Over budget, give up the finest level of whichever texture was requested longest ago, or of the one
+        // with the finest level among those requested equally recently.
+        while (_stats.budgetBytes > 0u && targetBytes > _stats.budgetBytes) {
+            size_t victim = _textures.size();
+            for (size_t i = 0; i < _textures.size(); ++i) {
+                const auto& streamed = _textures[i];
+                if (targets[i] >= streamed.minimumLevel)
+                    continue;
+
+                if (victim == _textures.size()
+                    || streamed.lastRequestFrame < _textures[victim].lastRequestFrame
+                    || (streamed.lastRequestFrame == _textures[victim].lastRequestFrame && targets[i] < targets[victim])
+                ) {
+                    victim = i;
+                }
+            }
+            if (victim == _textures.size())
+                break;
+
+            const auto& streamed = _textures[victim];
+            targetBytes -= streamed.tailBytes[targets[victim]] - streamed.tailBytes[targets[victim] + 1u];
+            targets[victim] += 1u;
+        }
+
+        // Levels already on their way count against the budget, and evictions go first so that the levels
+        // streamed in next never push the resident total past it.
+        VkDeviceSize committedBytes = 0u;
+        for (const auto& streamed : _textures) {
+            committedBytes += streamed.tailBytes[std::min(streamed.residentLevel, streamed.pendingLevel)];
+        }
+
+        std::vector<residency_change> changes;
+        for (size_t i = 0; i < _textures.size(); ++i) {
+            auto& streamed = _textures[i];
+            if (streamed.pendingLevel != streamed.residentLevel || targets[i] <= streamed.residentLevel)
+                continue;
+
+            committedBytes -= streamed.tailBytes[streamed.residentLevel] - streamed.tailBytes[targets[i]];
+            changes.push_back(residency_change { static_cast<uint32_t>(i), targets[i] });
+            streamed.pendingLevel = targets[i];
+        }
+
+        // finer levels arrive one per change so each upload stays small
+        for (size_t i = 0; i < _textures.size(); ++i) {
+            auto& streamed = _textures[i];
+            if (streamed.pendingLevel != streamed.residentLevel || targets[i] >= streamed.residentLevel)
+                continue;
+
+            uint32_t baseLevel = streamed.residentLevel - 1u;
+            VkDeviceSize levelBytes = streamed.tailBytes[baseLevel] - streamed.tailBytes[streamed.residentLevel];
+            if (_stats.budgetBytes > 0u && committedBytes + levelBytes > _stats.budgetBytes)
+                continue;
+
+            committedBytes += levelBytes;
+            changes.push_back(residency_change { static_cast<uint32_t>(i), baseLevel });
+            streamed.pendingLevel = baseLevel;
+        }
+        return changes;
+    }
+}
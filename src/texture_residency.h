@@ -0,0 +1,68 @@
+#pragma once
+
+#include "texture_file.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct texture_residency_stats {
+        uint32_t textureCount;
+        VkDeviceSize budgetBytes;
+        VkDeviceSize residentBytes;
+        VkDeviceSize peakResidentBytes;
+        uint64_t levelsStreamedIn;
+        VkDeviceSize bytesStreamedIn;
+        uint64_t levelsEvicted;
+        VkDeviceSize bytesEvicted;
+    };
+
+    // Make levels [baseLevel, levelCount) of a texture resident, streaming in or evicting whatever differs.
+    struct residency_change {
+        uint32_t texture;
+        uint32_t baseLevel;
+    };
+
+    // Decides which mip levels of each streamed texture should be resident. Textures start out with only their
+    // smallest levels; every frame the renderer requests the finest level it would sample, and update() streams
+    // finer levels in one at a time while evicting the finest levels of the least recently requested textures
+    // whenever the resident total would exceed the budget. Only bookkeeping lives here, the renderer carries the
+    // changes out and reports back with setResident().
+    class texture_residency {
+    public:
+        // frames without a request after which a texture drops back to its initial levels
+        static const uint64_t UNUSED_FRAMES = 120u;
+
+        // A budget of zero leaves residency up to demand alone.
+        explicit texture_residency(VkDeviceSize budgetBytes = 0u);
+
+        // Registers a texture whose levels from baseLevel on have just been made resident. Those levels are never
+        // evicted.
+        uint32_t add(const std::vector<texture_level>& levels, uint32_t baseLevel);
+        void request(uint32_t texture, uint32_t level, uint64_t frame);
+        // Returns at most one change per texture, and none for textures whose previous change is still underway.
+        std::vector<residency_change> update(uint64_t frame);
+        void setResident(uint32_t texture, uint32_t baseLevel);
+
+        uint32_t getResidentLevel(uint32_t texture) const { return _textures[texture].residentLevel; }
+        VkDeviceSize getResidentBytes(uint32_t texture) const;
+        const texture_residency_stats& getStats() const { return _stats; }
+        void printStats(std::ostream& out) const;
+
+    private:
+        struct streamed_texture {
+            // bytes from each level up to the end of the chain
+            std::vector<VkDeviceSize> tailBytes;
+            uint32_t minimumLevel;
+            uint32_t residentLevel;
+            // differs from residentLevel while a change is underway
+            uint32_t pendingLevel;
+            uint32_t requestedLevel;
+            uint64_t lastRequestFrame;
+        };
+
+        texture_residency_stats _stats;
+        std::vector<streamed_texture> _textures;
+    };
+}
@@ -0,0 +1,122 @@
+#include "uniform_ring_buffer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace vulkan_tutorial {
+    uniform_ring_buffer::uniform_ring_buffer()
+      : _alignment {1u},
+        _allocator {nullptr},
+        _allocation {},
+        _buffer {VK_NULL_HANDLE},
+        _currentFrame {0u},
+        _device {VK_NULL_HANDLE},
+        _frameSizes {},
+        _head {0u},
+        _size {0u},
+        _used {0u}
+    {}
+
+    uniform_ring_buffer::~uniform_ring_buffer() {
+        destroy();
+    }
+
+    uniform_allocation uniform_ring_buffer::allocate(VkDeviceSize size) {
+        VkDeviceSize offset = (_head + _alignment - 1u) / _alignment * _alignment;
+        VkDeviceSize padding = offset - _head;
+
+        // never split an allocation across the end of the buffer, skip the tail and start over at zero
+        if (offset + size > _size) {
+            padding = _size - _head;
+            offset = 0u;
+        }
+
+        if (_used + padding + size > _size)
+            throw std::runtime_error("uniform ring buffer exhausted");
+
+        _head = offset + size;
+        _used += padding + size;
+        _frameSizes[_currentFrame] += padding + size;
+
+        uniform_allocation allocation = {};
+        allocation.dynamicOffset = static_cast<uint32_t>(offset);
+        allocation.data = static_cast<char*>(_allocation.mapped) + offset;
+        return allocation;
+    }
+
+    void uniform_ring_buffer::beginFrame(uint32_t frameIndex) {
+        if (frameIndex >= _frameSizes.size())
+            throw std::out_of_range("uniform ring buffer frame index out of range");
+
+        // everything written by the frame that last used this index has been consumed by the GPU
+        _used -= _frameSizes[frameIndex];
+        _frameSizes[frameIndex] = 0u;
+        _currentFrame = frameIndex;
+    }
+
+    void uniform_ring_buffer::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        vkDestroyBuffer(_device, _buffer, nullptr);
+        _allocator->free(_allocation);
+
+        _alignment = 1u;
+        _allocator = nullptr;
+        _allocation = {};
+        _buffer = VK_NULL_HANDLE;
+        _currentFrame = 0u;
+        _device = VK_NULL_HANDLE;
+        _frameSizes.clear();
+        _head = 0u;
+        _size = 0u;
+        _used = 0u;
+    }
+
+    void uniform_ring_buffer::init(
+        VkPhysicalDevice physicalDevice,
+        VkDevice device,
+        device_memory_allocator* allocator,
+        VkDeviceSize size,
+        uint32_t frameCount
+    ) {
+        destroy();
+
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VkResult result = vkCreateBuffer(device, &bufferInfo, nullptr, &_buffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create uniform ring buffer");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, _buffer, &memRequirements);
+
+        // destroy() releases the buffer if anything below throws
+        _allocator = allocator;
+        _device = device;
+
+        _allocation = allocator->allocate(
+            memRequirements,
+            allocator->findMemoryType(
+                memRequirements.memoryTypeBits,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+            resource_kind::linear);
+
+        result = vkBindBufferMemory(device, _buffer, _allocation.memory, _allocation.offset);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to bind uniform ring buffer memory");
+
+        _alignment = std::max<VkDeviceSize>(deviceProperties.limits.minUniformBufferOffsetAlignment, 1u);
+        _frameSizes.assign(frameCount, 0u);
+        _head = 0u;
+        _size = size;
+        _used = 0u;
+    }
+}
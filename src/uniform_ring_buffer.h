@@ -0,0 +1,60 @@
+#pragma once
+
+#include "device_memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace vulkan_tutorial {
+    struct uniform_allocation {
+        uint32_t dynamicOffset;
+        void* data;
+    };
+
+    // A single persistently mapped, host coherent uniform buffer that per-frame uniform data is sub-allocated from.
+    // Allocations are aligned to minUniformBufferOffsetAlignment and bound with dynamic offsets. The bytes written
+    // during a frame are only reclaimed by the next beginFrame() on the same frame index, so the caller has to have
+    // waited on that frame's fence first.
+    class uniform_ring_buffer {
+    public:
+        uniform_ring_buffer();
+        ~uniform_ring_buffer();
+
+        uniform_ring_buffer(const uniform_ring_buffer&) = delete;
+        uniform_ring_buffer& operator=(const uniform_ring_buffer&) = delete;
+
+        void init(
+            VkPhysicalDevice physicalDevice,
+            VkDevice device,
+            device_memory_allocator* allocator,
+            VkDeviceSize size,
+            uint32_t frameCount);
+        void destroy();
+
+        void beginFrame(uint32_t frameIndex);
+        uniform_allocation allocate(VkDeviceSize size);
+
+        template<typename T>
+        uint32_t push(const T& data) {
+            uniform_allocation allocation = allocate(sizeof(T));
+            *static_cast<T*>(allocation.data) = data;
+            return allocation.dynamicOffset;
+        }
+
+        VkDeviceSize getAlignment() const { return _alignment; }
+        VkBuffer getBuffer() const { return _buffer; }
+        VkDeviceSize getSize() const { return _size; }
+
+    private:
+        VkDeviceSize _alignment;
+        device_memory_allocator* _allocator;
+        device_allocation _allocation;
+        VkBuffer _buffer;
+        uint32_t _currentFrame;
+        VkDevice _device;
+        std::vector<VkDeviceSize> _frameSizes;
+        VkDeviceSize _head;
+        VkDeviceSize _size;
+        VkDeviceSize _used;
+    };
+}
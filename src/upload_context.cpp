@@ -0,0 +1,241 @@
+#include "upload_context.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace vulkan_tutorial {
+    upload_context::upload_context()
+      : _allocator {nullptr},
+        _commandPool {VK_NULL_HANDLE},
+        _completedTicket {0u},
+        _device {VK_NULL_HANDLE},
+        _freeBatches {},
+        _inFlightBatches {},
+        _nextTicket {1u},
+        _queue {VK_NULL_HANDLE},
+        _recordingBatch {},
+        _recording {false}
+    {}
+
+    upload_context::~upload_context() {
+        destroy();
+    }
+
+    upload_context::upload_batch upload_context::acquireBatch() {
+        if (!_freeBatches.empty()) {
+            upload_batch batch = std::move(_freeBatches.back());
+            _freeBatches.pop_back();
+            return batch;
+        }
+
+        upload_batch batch = {};
+
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = _commandPool;
+        allocInfo.commandBufferCount = 1u;
+
+        VkResult result = vkAllocateCommandBuffers(_device, &allocInfo, &batch.commandBuffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate upload command buffer");
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        result = vkCreateFence(_device, &fenceInfo, nullptr, &batch.fence);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create upload fence");
+
+        return batch;
+    }
+
+    void upload_context::collect() {
+        while (!_inFlightBatches.empty()) {
+            auto& batch = _inFlightBatches.front();
+            if (vkGetFenceStatus(_device, batch.fence) != VK_SUCCESS)
+                break;
+
+            _completedTicket = batch.ticket;
+            retire(batch);
+            _freeBatches.push_back(std::move(batch));
+            _inFlightBatches.pop_front();
+        }
+    }
+
+    void upload_context::destroy() {
+        if (_device == VK_NULL_HANDLE)
+            return;
+
+        waitIdle();
+
+        for (const auto& batch : _freeBatches) {
+            vkDestroyFence(_device, batch.fence, nullptr);
+        }
+        vkDestroyCommandPool(_device, _commandPool, nullptr);
+
+        _allocator = nullptr;
+        _commandPool = VK_NULL_HANDLE;
+        _completedTicket = 0u;
+        _device = VK_NULL_HANDLE;
+        _freeBatches.clear();
+        _nextTicket = 1u;
+        _queue = VK_NULL_HANDLE;
+    }
+
+    uint64_t upload_context::flush(upload_context* consumer) {
+        if (!_recording)
+            return _nextTicket - 1u;
+
+        // Make every transfer write in the batch visible to whatever is submitted to the queue afterwards.
+        VkMemoryBarrier barrier = {};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+        vkCmdPipelineBarrier(
+            _recordingBatch.commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+            1u, &barrier,
+            0u, nullptr,
+            0u, nullptr
+        );
+
+        VkResult result = vkEndCommandBuffer(_recordingBatch.commandBuffer);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to record upload command buffer");
+
+        VkSemaphore signalSemaphore = VK_NULL_HANDLE;
+        if (consumer != nullptr) {
+            VkSemaphoreCreateInfo semaphoreInfo = {};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            result = vkCreateSemaphore(_device, &semaphoreInfo, nullptr, &signalSemaphore);
+            if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to create upload semaphore");
+        }
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.waitSemaphoreCount = static_cast<uint32_t>(_recordingBatch.waitSemaphores.size());
+        submitInfo.pWaitSemaphores = _recordingBatch.waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = _recordingBatch.waitStages.data();
+        submitInfo.commandBufferCount = 1u;
+        submitInfo.pCommandBuffers = &_recordingBatch.commandBuffer;
+        submitInfo.signalSemaphoreCount = signalSemaphore == VK_NULL_HANDLE ? 0u : 1u;
+        submitInfo.pSignalSemaphores = &signalSemaphore;
+
+        result = vkQueueSubmit(_queue, 1u, &submitInfo, _recordingBatch.fence);
+        if (result != VK_SUCCESS) {
+            vkDestroySemaphore(_device, signalSemaphore, nullptr);
+            throw std::runtime_error("failed to submit upload command buffer");
+        }
+
+        // The consumer owns the semaphore from here on and destroys it once its waiting batch has retired.
+        if (consumer != nullptr)
+            consumer->waitForSemaphore(signalSemaphore, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+        _recordingBatch.ticket = _nextTicket++;
+        _inFlightBatches.push_back(std::move(_recordingBatch));
+        _recordingBatch = {};
+        _recording = false;
+
+        return _inFlightBatches.back().ticket;
+    }
+
+    VkCommandBuffer upload_context::getCommandBuffer() {
+        if (_recording)
+            return _recordingBatch.commandBuffer;
+
+        collect();
+        _recordingBatch = acquireBatch();
+
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        VkResult result = vkBeginCommandBuffer(_recordingBatch.commandBuffer, &beginInfo);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to begin upload command buffer");
+
+        _recording = true;
+        return _recordingBatch.commandBuffer;
+    }
+
+    void upload_context::init(
+        VkDevice device,
+        VkQueue queue,
+        uint32_t queueFamilyIndex,
+        device_memory_allocator* allocator
+    ) {
+        destroy();
+
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        VkResult result = vkCreateCommandPool(device, &poolInfo, nullptr, &_commandPool);
+        if (result != VK_SUCCESS)
+            throw std::runtime_error("failed to create upload command pool");
+
+        _allocator = allocator;
+        _device = device;
+        _queue = queue;
+    }
+
+    bool upload_context::isComplete(uint64_t ticket) {
+        collect();
+        return ticket <= _completedTicket;
+    }
+
+    void upload_context::releaseAfterUpload(VkBuffer buffer, const device_allocation& allocation) {
+        if (!_recording)
+            throw std::logic_error("staging buffer released outside of an upload batch");
+
+        _recordingBatch.stagingBuffers.push_back(staging_buffer { buffer, allocation });
+    }
+
+    void upload_context::retire(upload_batch& batch) {
+        for (auto& stagingBuffer : batch.stagingBuffers) {
+            vkDestroyBuffer(_device, stagingBuffer.buffer, nullptr);
+            _allocator->free(stagingBuffer.allocation);
+        }
+        batch.stagingBuffers.clear();
+
+        for (auto semaphore : batch.waitSemaphores) {
+            vkDestroySemaphore(_device, semaphore, nullptr);
+        }
+        batch.waitSemaphores.clear();
+        batch.waitStages.clear();
+
+        vkResetFences(_device, 1u, &batch.fence);
+        vkResetCommandBuffer(batch.commandBuffer, 0u);
+    }
+
+    void upload_context::wait(uint64_t ticket) {
+        if (ticket >= _nextTicket)
+            throw std::invalid_argument("waiting on an upload batch that was never submitted");
+
+        std::vector<VkFence> fences;
+        for (const auto& batch : _inFlightBatches) {
+            if (batch.ticket <= ticket)
+                fences.push_back(batch.fence);
+        }
+
+        if (!fences.empty())
+            vkWaitForFences(_device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, UINT64_MAX);
+
+        collect();
+    }
+
+    void upload_context::waitForSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stage) {
+        getCommandBuffer();
+        _recordingBatch.waitSemaphores.push_back(semaphore);
+        _recordingBatch.waitStages.push_back(stage);
+    }
+
+    void upload_context::waitIdle() {
+        wait(flush());
+    }
+}
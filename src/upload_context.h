@@ -0,0 +1,64 @@
+#pragma once
+
+#include "device_memory_allocator.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace vulkan_tutorial {
+    // Collects transfer and layout transition commands into one command buffer and submits them as a single batch.
+    // Each flush() yields a ticket that can be polled or waited on; staging buffers handed to releaseAfterUpload()
+    // are destroyed once the batch that reads them has completed. Flushing with a consumer makes the consumer's next
+    // batch wait on this one, which is how work is handed from the transfer queue to the graphics queue.
+    class upload_context {
+    public:
+        upload_context();
+        ~upload_context();
+
+        upload_context(const upload_context&) = delete;
+        upload_context& operator=(const upload_context&) = delete;
+
+        void init(VkDevice device, VkQueue queue, uint32_t queueFamilyIndex, device_memory_allocator* allocator);
+        void destroy();
+
+        VkCommandBuffer getCommandBuffer();
+        void releaseAfterUpload(VkBuffer buffer, const device_allocation& allocation);
+        void waitForSemaphore(VkSemaphore semaphore, VkPipelineStageFlags stage);
+
+        uint64_t flush(upload_context* consumer = nullptr);
+        bool isComplete(uint64_t ticket);
+        void wait(uint64_t ticket);
+        void waitIdle();
+
+    private:
+        struct staging_buffer {
+            VkBuffer buffer;
+            device_allocation allocation;
+        };
+
+        struct upload_batch {
+            VkCommandBuffer commandBuffer;
+            VkFence fence;
+            uint64_t ticket;
+            std::vector<staging_buffer> stagingBuffers;
+            std::vector<VkSemaphore> waitSemaphores;
+            std::vector<VkPipelineStageFlags> waitStages;
+        };
+
+        device_memory_allocator* _allocator;
+        VkCommandPool _commandPool;
+        uint64_t _completedTicket;
+        VkDevice _device;
+        std::vector<upload_batch> _freeBatches;
+        std::deque<upload_batch> _inFlightBatches;
+        uint64_t _nextTicket;
+        VkQueue _queue;
+        upload_batch _recordingBatch;
+        bool _recording;
+
+        upload_batch acquireBatch();
+        void collect();
+        void retire(upload_batch& batch);
+    };
+}
@@ -0,0 +1,123 @@
+#include "vertex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+    uint16_t quantizeUnorm16(float value, float offset, float scale) {
+        float normalized = scale > 0.0f ? (value - offset) / scale : 0.0f;
+        return static_cast<uint16_t>(std::lround(std::min(std::max(normalized, 0.0f), 1.0f) * 65535.0f));
+    }
+}
+
+namespace vulkan_tutorial {
+    std::array<VkVertexInputAttributeDescription, 2> vertex::getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+        attributeDescriptions[0].binding = 0u;
+        attributeDescriptions[0].location = 0u;
+        attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescriptions[0].offset = offsetof(vertex, pos);
+
+        attributeDescriptions[1].binding = 0u;
+        attributeDescriptions[1].location = 1u;
+        attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+        attributeDescriptions[1].offset = offsetof(vertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    VkVertexInputBindingDescription vertex::getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 0u;
+        bindingDescription.stride = sizeof(vertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    vertex_quantization vertex_quantization::fromBounds(const vertex* vertices, size_t count) {
+        vertex_quantization quantization = {};
+        if (count == 0u)
+            return quantization;
+
+        glm::vec3 minPosition = vertices[0].pos;
+        glm::vec3 maxPosition = vertices[0].pos;
+        glm::vec2 minTexCoord = vertices[0].texCoord;
+        glm::vec2 maxTexCoord = vertices[0].texCoord;
+        for (size_t i = 1; i < count; ++i) {
+            minPosition = glm::min(minPosition, vertices[i].pos);
+            maxPosition = glm::max(maxPosition, vertices[i].pos);
+            minTexCoord = glm::min(minTexCoord, vertices[i].texCoord);
+            maxTexCoord = glm::max(maxTexCoord, vertices[i].texCoord);
+        }
+
+        quantization.positionOffset = minPosition;
+        quantization.positionScale = maxPosition - minPosition;
+        quantization.texCoordOffset = minTexCoord;
+        quantization.texCoordScale = maxTexCoord - minTexCoord;
+        return quantization;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 2> compact_vertex::getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions = {};
+
+        attributeDescriptions[0].binding = 0u;
+        attributeDescriptions[0].location = 0u;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[0].offset = offsetof(compact_vertex, pos);
+
+        attributeDescriptions[1].binding = 0u;
+        attributeDescriptions[1].location = 1u;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+        attributeDescriptions[1].offset = offsetof(compact_vertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    VkVertexInputBindingDescription compact_vertex::getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 0u;
+        bindingDescription.stride = sizeof(compact_vertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    compact_vertex compact_vertex::quantize(const vertex& v, const vertex_quantization& quantization) {
+        compact_vertex compact = {};
+        for (int i = 0; i < 3; ++i) {
+            compact.pos[i] = quantizeUnorm16(v.pos[i], quantization.positionOffset[i], quantization.positionScale[i]);
+        }
+        compact.pos[3] = 65535u;
+        for (int i = 0; i < 2; ++i) {
+            compact.texCoord[i] = quantizeUnorm16(
+                v.texCoord[i], quantization.texCoordOffset[i], quantization.texCoordScale[i]);
+        }
+        return compact;
+    }
+
+    std::array<VkVertexInputAttributeDescription, 4> instance_data::getAttributeDescriptions() {
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {};
+
+        for (uint32_t i = 0u; i < 4u; ++i) {
+            attributeDescriptions[i].binding = 1u;
+            attributeDescriptions[i].location = 2u + i;
+            attributeDescriptions[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[i].offset = static_cast<uint32_t>(
+                offsetof(instance_data, transform) + sizeof(glm::vec4) * i);
+        }
+
+        return attributeDescriptions;
+    }
+
+    VkVertexInputBindingDescription instance_data::getBindingDescription() {
+        VkVertexInputBindingDescription bindingDescription = {};
+        bindingDescription.binding = 1u;
+        bindingDescription.stride = sizeof(instance_data);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace vulkan_tutorial {
+    struct vertex {
+        glm::vec3 pos;
+        glm::vec2 texCoord;
+
+        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
+        static VkVertexInputBindingDescription getBindingDescription();
+
+        bool operator==(const vertex& other) const {
+            return pos == other.pos && texCoord == other.texCoord;
+        }
+    };
+
+    // Maps the bounds of a mesh onto the 16-bit normalized range of compact_vertex and back.
+    struct vertex_quantization {
+        glm::vec3 positionOffset;
+        glm::vec3 positionScale;
+        glm::vec2 texCoordOffset;
+        glm::vec2 texCoordScale;
+
+        static vertex_quantization fromBounds(const vertex* vertices, size_t count);
+    };
+
+    // 12 instead of 20 bytes: position and texture coordinates as 16-bit normalized values relative to the mesh
+    // bounds. The vertex input unit turns them back into floats in [0, 1]; the model matrix and a texture coordinate
+    // transform undo the quantization.
+    struct compact_vertex {
+        // the fourth component only pads the position to a format every implementation can fetch
+        uint16_t pos[4];
+        uint16_t texCoord[2];
+
+        static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
+        static VkVertexInputBindingDescription getBindingDescription();
+
+        static compact_vertex quantize(const vertex& v, const vertex_quantization& quantization);
+    };
+
+    // Per-instance data read from a second, instance-rate binding. The matrix takes one attribute location per
+    // column.
+    struct instance_data {
+        glm::mat4 transform;
+
+        static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions();
+        static VkVertexInputBindingDescription getBindingDescription();
+    };
+}